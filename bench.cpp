@@ -0,0 +1,211 @@
+/*
+ * bench - throughput and latency of all EANSearch methods against a local mock of the API
+ *
+ * Starts a MockAPIServer on a free local port and runs each method with an
+ * increasing number of concurrent callers sharing one EANSearch object.
+ * No API token or network access is needed, so results are reproducible
+ * and comparable between library versions.
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include "eansearch.hpp"
+#include "eansearch_mock.hpp"
+using namespace std;
+
+struct Suite {
+	const char * name;
+	/// Make call number i, return false on failure
+	function<bool(EANSearch &, int)> call;
+};
+
+static string Ean(int i) {
+	string n = to_string(i % 100000);
+	return "40072490" + string(5 - n.size(), '0') + n;
+}
+
+static bool Deleted(Product * p) {
+	delete p;
+	return p != nullptr;
+}
+
+static bool Deleted(ProductList * pl) {
+	DeleteProductList(pl);
+	return pl != nullptr;
+}
+
+/// Barcodes per call of the batch suite
+const int BATCH_SIZE = 16;
+
+static bool Deleted(vector<ProductFull *> products) {
+	bool found = true;
+	for (auto p : products) {
+		found = found && p != nullptr;
+		delete p;
+	}
+	return found;
+}
+
+static const Suite SUITES[] = {
+	{ "BarcodeLookup", [](EANSearch & api, int i) { return Deleted(api.BarcodeLookup(Ean(i))); } },
+	{ "BatchBarcodeLookup", [](EANSearch & api, int i) {
+		vector<string> eans;
+		for (int n = 0; n < BATCH_SIZE; n++) {
+			eans.push_back(Ean(i * BATCH_SIZE + n));
+		}
+		return Deleted(api.BatchBarcodeLookup(eans)); } },
+	{ "IsbnLookup", [](EANSearch & api, int i) { return Deleted(api.IsbnLookup("111957888" + to_string(i % 10))); } },
+	{ "VerifyChecksum", [](EANSearch & api, int i) { return api.VerifyChecksum(Ean(i)); } },
+	{ "ProductSearch", [](EANSearch & api, int i) { return Deleted(api.ProductSearch("Bananaboat", Any, i % 10)); } },
+	{ "SimilarProductSearch", [](EANSearch & api, int i) {
+		return Deleted(api.SimilarProductSearch("iPhone Max whatever", Any, i % 10)); } },
+	{ "CategorySearch", [](EANSearch & api, int i) { return Deleted(api.CategorySearch(45, "Thriller", Any, i % 10)); } },
+	{ "BarcodePrefixSearch", [](EANSearch & api, int i) { return Deleted(api.BarcodePrefixSearch("4007249", English, i % 10)); } },
+	{ "IssuingCountryLookup", [](EANSearch & api, int i) { return !api.IssuingCountryLookup(Ean(i)).empty(); } },
+	{ "BarcodeImage", [](EANSearch & api, int i) { return !api.BarcodeImage(Ean(i), 102, 50).empty(); } },
+	{ "AccountStatus", [](EANSearch & api, int) { string r; return api.Query("op=account-status", r); } }
+};
+
+static void Usage() {
+	cerr << "Usage: bench [options]" << endl
+		<< "  --suite NAME         run only this suite (default: all)" << endl
+		<< "  --threads N,N,...    concurrent callers (default 1,4,16,64,256)" << endl
+		<< "  --calls N            calls per suite and thread count (default 1000)" << endl
+		<< "  --latency MICROS     mock server delay per response (default 0)" << endl
+		<< "  --tail SHARE         share of responses delayed by --tail-latency, 0..1 (default 0)" << endl
+		<< "  --tail-latency MICROS  additional delay of the tail (default 50000)" << endl
+		<< "  --throttle SHARE     share of responses with status 429, 0..1 (default 0)" << endl
+		<< "  --page-size N        products per search result (default 10)" << endl
+		<< "  --gzip 0|1           compress responses (default 0)" << endl
+		<< "  --http2 N            multiplex over N HTTP/2 connections (default 0: HTTP/1.1)" << endl
+		<< "  --pipeline N         requests in flight per connection in batches (default 1)" << endl
+		<< "  --hedge PERCENTILE   hedge BarcodeLookup after this latency percentile (default 0: off)" << endl
+		<< "  --max-requests N     requests per connection before the server closes it (default 0: no limit)" << endl;
+}
+
+/**
+ * @brief Run one suite with a number of callers, print throughput and latency.
+ */
+static void Run(const Suite & suite, int threads, int calls, unsigned short port, int http2, int pipeline, double hedge) {
+	EANSearch api("mock-token");
+	api.SetEndpoint("localhost", to_string(port));
+	api.SetHttp2(http2);
+	api.SetPipelineDepth(pipeline);
+	api.SetHedging(hedge);
+	atomic<int> next(0);
+	atomic<int> errors(0);
+	vector<vector<uint64_t>> latencies(threads);
+	auto start = chrono::steady_clock::now();
+	vector<thread> callers;
+	for (int t = 0; t < threads; t++) {
+		callers.emplace_back([&, t]() {
+			for (int i; (i = next++) < calls; ) {
+				auto before = chrono::steady_clock::now();
+				if (!suite.call(api, i)) {
+					errors++;
+				}
+				latencies[t].push_back(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - before).count());
+			}
+		});
+	}
+	for (auto & c : callers) {
+		c.join();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	vector<uint64_t> all;
+	for (auto & l : latencies) {
+		all.insert(all.end(), l.begin(), l.end());
+	}
+	sort(all.begin(), all.end());
+	auto percentile = [&all](double p) { return all.empty() ? 0 : all[min(all.size() - 1, (size_t)(p / 100 * all.size()))]; };
+	cout << left << setw(22) << suite.name << right << setw(8) << threads << setw(8) << calls
+		<< setw(12) << fixed << setprecision(0) << calls / seconds
+		<< setw(10) << percentile(50) << setw(10) << percentile(99) << setw(8) << errors << endl;
+}
+
+int main(int argc, char * argv[]) {
+	string only;
+	vector<int> thread_counts = { 1, 4, 16, 64, 256 };
+	int calls = 1000;
+	int http2 = 0;
+	int pipeline = 1;
+	double hedge = 0;
+	double tail = 0;
+	int tail_latency = 50000;
+	MockAPIServer server;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (i + 1 >= argc) {
+			Usage();
+			return 1;
+		}
+		string value = argv[++i];
+		if (arg == "--suite") {
+			only = value;
+		} else if (arg == "--threads") {
+			thread_counts.clear();
+			stringstream list(value);
+			for (string n; getline(list, n, ','); ) {
+				thread_counts.push_back(stoi(n));
+			}
+		} else if (arg == "--calls") {
+			calls = stoi(value);
+		} else if (arg == "--latency") {
+			server.SetLatency(stoi(value));
+		} else if (arg == "--tail") {
+			tail = stod(value);
+		} else if (arg == "--tail-latency") {
+			tail_latency = stoi(value);
+		} else if (arg == "--throttle") {
+			server.SetThrottle(stod(value));
+		} else if (arg == "--gzip") {
+			server.SetCompression(value == "1");
+		} else if (arg == "--http2") {
+			http2 = stoi(value);
+			if (!server.SetHttp2(http2 > 0)) {
+				cerr << "Error: built without EANSEARCH_HTTP2" << endl;
+				return 1;
+			}
+		} else if (arg == "--pipeline") {
+			pipeline = stoi(value);
+		} else if (arg == "--hedge") {
+			hedge = stod(value);
+		} else if (arg == "--max-requests") {
+			server.SetMaxRequests(stoi(value));
+		} else if (arg == "--page-size") {
+			server.SetPageSize(stoi(value));
+		} else {
+			Usage();
+			return 1;
+		}
+	}
+
+	server.SetTail(tail, tail_latency);
+	if (!server.Listen()) {
+		return 1;
+	}
+	cout << left << setw(22) << "suite" << right << setw(8) << "threads" << setw(8) << "calls"
+		<< setw(12) << "calls/s" << setw(10) << "p50 us" << setw(10) << "p99 us" << setw(8) << "errors" << endl;
+	for (auto & suite : SUITES) {
+		if (!only.empty() && only != suite.name) {
+			continue;
+		}
+		for (int threads : thread_counts) {
+			Run(suite, threads, calls, server.Port(), http2, pipeline, hedge);
+		}
+	}
+	server.Stop();
+	return 0;
+}
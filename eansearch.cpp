@@ -8,9 +8,30 @@
 */
 
 #include "eansearch.hpp"
+#include "eansearch_codec.hpp"
+#include "eansearch_snapshot.hpp"
+#include "eansearch_textindex.hpp"
+#include "eansearch_similarity.hpp"
+#include "eansearch_pool.hpp"
+#include "eansearch_http2.hpp"
+#include "eansearch_hedge.hpp"
+#include "eansearch_breaker.hpp"
+#include "eansearch_scheduler.hpp"
+#include "eansearch_budget.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <numeric>
+#include <random>
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/asio/connect.hpp>
@@ -37,7 +58,153 @@ void DeleteProductList(ProductList * pl) {
     }
 }
 
-static Product * ProductFromJSON(const json::value & api_result) {
+/**
+ * @brief Counts a request as in flight until it goes out of scope.
+ */
+class InFlightGuard {
+public:
+    InFlightGuard(ClientMetrics & metrics) : metrics(metrics) { }
+    ~InFlightGuard() { metrics.AddInFlight(-1); }
+private:
+    ClientMetrics & metrics;
+};
+
+/**
+ * @brief Gives the place of a request in the scheduler back when it is done.
+ */
+class SchedulerSlot {
+public:
+    SchedulerSlot(RequestScheduler * scheduler) : scheduler(scheduler) { }
+    ~SchedulerSlot() { Release(); }
+    void Release() {
+        if (scheduler) {
+            scheduler->Release();
+            scheduler = nullptr;
+        }
+    }
+private:
+    RequestScheduler * scheduler;
+};
+
+/**
+ * @brief Leaves the bulkhead of an operation when a call returns.
+ */
+class BulkheadGuard {
+public:
+    BulkheadGuard(Bulkhead * bulkhead, int op) : bulkhead(bulkhead), op(op) { }
+    ~BulkheadGuard() {
+        if (bulkhead) {
+            bulkhead->Leave(op);
+        }
+    }
+private:
+    Bulkhead * bulkhead;
+    int op;
+};
+
+/**
+ * @brief Time to wait before sending a request throttled with status 429 again.
+ * @param tries Attempts so far.
+ *
+ * Exponential backoff with jitter, so throttled callers don't all come back at once.
+ */
+static chrono::milliseconds Backoff(int tries) {
+    thread_local mt19937 random(random_device{}());
+    int64_t limit = min<int64_t>(BACKOFF_MAX_MS, (int64_t)BACKOFF_BASE_MS << min(tries - 1, 16));
+    return chrono::milliseconds(uniform_int_distribution<int64_t>(limit / 2, limit)(random));
+}
+
+/**
+ * @brief Buffer of this thread for the query parameters of a request.
+ *
+ * The buffer keeps its capacity, so building a request doesn't allocate
+ * once the thread has sent a request of the same size.
+ */
+static string & RequestParams() {
+    thread_local string params;
+    return params;
+}
+
+/**
+ * @brief Response buffer of this thread, reused by the next request.
+ */
+static string & ResponseBuffer() {
+    thread_local string result;
+    return result;
+}
+
+static void AppendNumber(string & out, int value) {
+    char digits[16];
+    auto end = to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end - digits);
+}
+
+static void AppendParam(string & out, const char * name, int value) {
+    out += name;
+    AppendNumber(out, value);
+}
+
+void BarcodeLookupParams(string & out, const string & ean, int language) {
+    out.assign("op=barcode-lookup&ean=");
+    out += ean;
+    AppendParam(out, "&language=", language);
+}
+
+void IsbnLookupParams(string & out, const string & isbn) {
+    out.assign("op=barcode-lookup&isbn=");
+    out += isbn;
+}
+
+void VerifyChecksumParams(string & out, const string & ean) {
+    out.assign("op=verify-checksum&ean=");
+    out += ean;
+}
+
+void SearchParams(string & out, const char * op, const string & name, int language, int page) {
+    out.assign(op);
+    urlencode(name, out);
+    AppendParam(out, "&language=", language);
+    AppendParam(out, "&page=", page);
+}
+
+void CategorySearchParams(string & out, int category, const string & name, int language, int page) {
+    out.assign("op=category-search&category=");
+    AppendNumber(out, category);
+    out += "&name=";
+    urlencode(name, out);
+    AppendParam(out, "&language=", language);
+    AppendParam(out, "&page=", page);
+}
+
+void PrefixSearchParams(string & out, const string & prefix, int language, int page) {
+    out.assign("op=barcode-prefix-search&prefix=");
+    out += prefix;
+    AppendParam(out, "&language=", language);
+    AppendParam(out, "&page=", page);
+}
+
+void IssuingCountryParams(string & out, const string & ean) {
+    out.assign("op=issuing-country&ean=");
+    out += ean;
+}
+
+void BarcodeImageParams(string & out, const string & ean, int width, int height) {
+    out.assign("op=barcode-image&ean=");
+    out += ean;
+    AppendParam(out, "&width=", width);
+    AppendParam(out, "&height=", height);
+}
+
+string_view OpOf(const string & params) {
+    if (params.compare(0, 3, "op=") != 0) {
+        return string_view();
+    }
+    string_view op(params);
+    op = op.substr(3);
+    return op.substr(0, op.find('&'));
+}
+
+Product * ProductFromJSON(const json::value & api_result) {
     Product * p = nullptr;
     auto json_product = api_result.if_object();
     if (json_product) {
@@ -57,29 +224,123 @@ static Product * ProductFromJSON(const json::value & api_result) {
     return p;
 }
 
+ProductFull * ParseBarcode(const string & result) {
+    try {
+        auto api_result = json::parse(result);
+        return dynamic_cast<ProductFull *>(ProductFromJSON(api_result.at(0)));
+    }
+    catch(std::exception const &) {
+        return nullptr;
+    }
+}
+
+/// Priority of the requests of this thread, see ScopedPriority
+static thread_local Priority thread_priority = PriorityNormal;
+
+ScopedPriority::ScopedPriority(Priority priority) {
+    this->previous = thread_priority;
+    thread_priority = priority;
+}
+
+ScopedPriority::~ScopedPriority() {
+    thread_priority = previous;
+}
+
+Priority ScopedPriority::Current() {
+    return thread_priority;
+}
+
 EANSearch::EANSearch(const string & token) {
     this->token = token;
+    this->suffix = "&token=" + token + "&format=json";
+    this->host = "api.ean-search.org";
+    this->port = "443";
 	this->remaining = -1;
+    this->cache = nullptr;
+    this->snapshot = nullptr;
+    this->snapshot_page_size = 10;
+    this->index = nullptr;
+    this->index_page_size = 10;
+    this->similarity = nullptr;
+    this->similarity_page_size = 10;
+    this->pool = new ConnectionPool();
+    this->http2 = nullptr;
+    this->hedger = nullptr;
+    this->breaker = nullptr;
+    this->bulkhead = new Bulkhead();
+    this->budget = nullptr;
+    this->scheduler = new RequestScheduler();
+    this->pipeline_depth = 1;
+}
+
+EANSearch::~EANSearch() {
+    delete hedger; // its workers use the pool
+    delete breaker;
+    delete bulkhead;
+    delete budget;
+    delete scheduler;
+    delete pool;
+#ifdef EANSEARCH_HTTP2
+    delete http2;
+#endif
 }
 
 ProductFull * EANSearch::BarcodeLookup(const string & ean, int language)
 {
-    string result;
-    if (APICall("op=barcode-lookup&ean=" + ean + "&language=" + to_string(language), result)) {
-        auto api_result = json::parse(result);
-        ProductFull * p = dynamic_cast<ProductFull *>(ProductFromJSON(api_result.at(0)));
+    if (snapshot && snapshot->Language() == language) {
+        ProductFull * p = snapshot->Lookup(ean);
+        if (p) {
+            return p;
+        }
+    }
+    string & result = ResponseBuffer();
+    string & params = RequestParams();
+    BarcodeLookupParams(params, ean, language);
+    if (CachedAPICall(params, result)) {
+        RequestTimer timer(metrics, "barcode-lookup");
+        ProductFull * p = ParseBarcode(result);
+        timer.Mark(PhaseParse);
         return p;
     } else {
         return nullptr;
     }
 }
 
+vector<ProductFull *> EANSearch::BatchBarcodeLookup(const vector<string> & eans, int language)
+{
+    vector<ProductFull *> products(eans.size(), nullptr);
+    vector<string> params;
+    vector<size_t> positions; // of params in eans
+    for (size_t i = 0; i < eans.size(); i++) {
+        if (snapshot && snapshot->Language() == language && (products[i] = snapshot->Lookup(eans[i]))) {
+            continue;
+        }
+        params.emplace_back();
+        BarcodeLookupParams(params.back(), eans[i], language);
+        positions.push_back(i);
+    }
+    vector<string> results;
+    CachedQueryBatch(params, results);
+    for (size_t j = 0; j < params.size(); j++) {
+        if (results[j].empty()) {
+            continue;
+        }
+        RequestTimer timer(metrics, "barcode-lookup");
+        products[positions[j]] = ParseBarcode(results[j]);
+        timer.Mark(PhaseParse);
+    }
+    return products;
+}
+
 ProductFull * EANSearch::IsbnLookup(const string & isbn)
 {
-    string result;
-    if (APICall("op=barcode-lookup&isbn=" + isbn, result)) {
-        auto api_result = json::parse(result);
-        ProductFull * p = dynamic_cast<ProductFull *>(ProductFromJSON(api_result.at(0)));
+    string & result = ResponseBuffer();
+    string & params = RequestParams();
+    IsbnLookupParams(params, isbn);
+    if (CachedAPICall(params, result)) {
+        RequestTimer timer(metrics, "barcode-lookup");
+        ProductFull * p = ParseBarcode(result);
+        timer.Mark(PhaseParse);
         return p;
     } else {
         return nullptr;
@@ -88,10 +349,15 @@ ProductFull * EANSearch::IsbnLookup(const string & isbn)
 
 bool EANSearch::VerifyChecksum(const string & ean)
 {
-    string result;
-    if (APICall("op=verify-checksum&ean=" + ean, result)) {
+    string & result = ResponseBuffer();
+    string & params = RequestParams();
+    VerifyChecksumParams(params, ean);
+    if (APICall(params, result)) {
+        RequestTimer timer(metrics, "verify-checksum");
         auto api_result = json::parse(result);
-        return (api_result.at(0).at("valid").as_string() == "1");
+        bool valid = (api_result.at(0).at("valid").as_string() == "1");
+        timer.Mark(PhaseParse);
+        return valid;
     } else {
         return false;
     }
@@ -99,49 +365,96 @@ bool EANSearch::VerifyChecksum(const string & ean)
 
 ProductList * EANSearch::ProductSearch(const string & name, int only_language, int page)
 {
-    string result;
-    if (APICall("op=product-search&name=" + urlencode(name) + "&language=" + to_string(only_language) + "&page=" + to_string(page), result)) {
-        return ParseProductList(result);
+    if (index && (only_language == Any || only_language == index->Language())) {
+        ProductList * pl = index->Search(name, -1, page, index_page_size);
+        if (pl) {
+            return pl;
+        }
+    }
+    string & result = ResponseBuffer();
+    string & params = RequestParams();
+    SearchParams(params, "op=product-search&name=", name, only_language, page);
+    if (APICall(params, result)) {
+        RequestTimer timer(metrics, "product-search");
+        ProductList * pl = ParseProductList(result);
+        timer.Mark(PhaseParse);
+        return pl;
     }
     return nullptr;
 }
 
 ProductList * EANSearch::SimilarProductSearch(const string & name, int only_language, int page)
 {
-    string result;
-    if (APICall("op=similar-product-search&name=" + urlencode(name) + "&language=" + to_string(only_language) + "&page=" + to_string(page), result)) {
-        return ParseProductList(result);
+    if (similarity && (only_language == Any || only_language == similarity->Language())) {
+        ProductList * pl = similarity->Search(name, page, similarity_page_size);
+        if (pl) {
+            return pl;
+        }
+    }
+    string & result = ResponseBuffer();
+    string & params = RequestParams();
+    SearchParams(params, "op=similar-product-search&name=", name, only_language, page);
+    if (APICall(params, result)) {
+        RequestTimer timer(metrics, "similar-product-search");
+        ProductList * pl = ParseProductList(result);
+        timer.Mark(PhaseParse);
+        return pl;
     }
     return nullptr;
 }
 
 ProductList * EANSearch::CategorySearch(int category, const string & name, int only_language, int page)
 {
-    string result;
-    if (APICall("op=category-search&category=" + to_string(category) + "&name=" + urlencode(name)
-                + "&language=" + to_string(only_language) + "&page=" + to_string(page), result)) {
-        return ParseProductList(result);
+    if (index && (only_language == Any || only_language == index->Language())) {
+        ProductList * pl = index->Search(name, category, page, index_page_size);
+        if (pl) {
+            return pl;
+        }
+    }
+    string & result = ResponseBuffer();
+    string & params = RequestParams();
+    CategorySearchParams(params, category, name, only_language, page);
+    if (APICall(params, result)) {
+        RequestTimer timer(metrics, "category-search");
+        ProductList * pl = ParseProductList(result);
+        timer.Mark(PhaseParse);
+        return pl;
     }
     return nullptr;
 }
 
 ProductList * EANSearch::BarcodePrefixSearch(const string & prefix, int language, int page)
 {
-    string result;
-    if (APICall("op=barcode-prefix-search&prefix=" + prefix
-                + "&language=" + to_string(language) + "&page=" + to_string(page), result)) {
-        return ParseProductList(result);
+    if (snapshot && snapshot->Language() == language) {
+        ProductList * pl = snapshot->PrefixSearch(prefix, page, snapshot_page_size);
+        if (pl) {
+            return pl;
+        }
+    }
+    string & result = ResponseBuffer();
+    string & params = RequestParams();
+    PrefixSearchParams(params, prefix, language, page);
+    if (APICall(params, result)) {
+        RequestTimer timer(metrics, "barcode-prefix-search");
+        ProductList * pl = ParseProductList(result);
+        timer.Mark(PhaseParse);
+        return pl;
     }
     return nullptr;
 }
 
 string EANSearch::IssuingCountryLookup(const string & ean)
 {
-    string result;
-    if (APICall("op=issuing-country&ean=" + ean, result)) {
+    string & result = ResponseBuffer();
+    string & params = RequestParams();
+    IssuingCountryParams(params, ean);
+    if (CachedAPICall(params, result)) {
+        RequestTimer timer(metrics, "issuing-country");
         error_code ec;
         auto api_result = json::parse(result, ec);
-        return api_result.at(0).at("issuingCountry").as_string().c_str();
+        string country = api_result.at(0).at("issuingCountry").as_string().c_str();
+        timer.Mark(PhaseParse);
+        return country;
     } else {
         return "";
     }
@@ -149,10 +462,15 @@ string EANSearch::IssuingCountryLookup(const string & ean)
 
 string EANSearch::BarcodeImage(const string & ean, int width, int height)
 {
-    string result;
-    if (APICall("op=barcode-image&ean=" + ean + "&width=" + to_string(width) + "&height=" + to_string(height), result)) {
+    string & result = ResponseBuffer();
+    string & params = RequestParams();
+    BarcodeImageParams(params, ean, width, height);
+    if (APICall(params, result)) {
+        RequestTimer timer(metrics, "barcode-image");
         auto api_result = json::parse(result);
-        return api_result.at(0).at("barcode").as_string().c_str();
+        string image = api_result.at(0).at("barcode").as_string().c_str();
+        timer.Mark(PhaseParse);
+        return image;
     } else {
         return "";
     }
@@ -160,7 +478,7 @@ string EANSearch::BarcodeImage(const string & ean, int width, int height)
 
 int EANSearch::CreditsRemaining()
 {
-    string result;
+    string & result = ResponseBuffer();
 	if (remaining < 0) {
 		if (!APICall("op=account-status", result)) {
 			return -1;
@@ -169,93 +487,977 @@ int EANSearch::CreditsRemaining()
 	return remaining;
 }
 
+MetricsSnapshot EANSearch::GetMetrics() const
+{
+    MetricsSnapshot snapshot = metrics.Snapshot();
+    snapshot.credits_remaining = remaining;
+    PoolStats pool_stats = pool->Stats();
+    snapshot.connections_busy = pool_stats.busy;
+    snapshot.connections_idle = pool_stats.idle;
+    snapshot.connections_opened = pool_stats.opened;
+    snapshot.connections_reused = pool_stats.reused;
+    if (breaker) {
+        snapshot.circuit_state = breaker->GetState();
+    }
+    if (budget) {
+        BudgetStatus status = budget->Status();
+        snapshot.credits_burn_rate = status.burn_rate;
+        snapshot.credits_projected = status.projected;
+        snapshot.credits_by_tag = status.by_tag;
+    }
+    for (int p = 0; p < PRIORITY_COUNT; p++) {
+        snapshot.queue_depth.push_back(scheduler->QueueDepth((Priority)p));
+    }
+#ifdef EANSEARCH_HTTP2
+    if (http2) {
+        PoolStats http2_stats = http2->Stats();
+        snapshot.connections_busy += http2_stats.busy;
+        snapshot.connections_opened += http2_stats.opened;
+        snapshot.connections_reused += http2_stats.reused;
+    }
+#endif
+    return snapshot;
+}
+
+void EANSearch::SetRateLimit(double requests_per_second, int burst)
+{
+    scheduler->SetRate(requests_per_second, burst);
+}
+
+void EANSearch::SetMaxInFlight(int requests)
+{
+    scheduler->SetMaxInFlight(requests);
+}
+
+void EANSearch::SetPriorityWeight(Priority priority, double weight)
+{
+    scheduler->SetWeight(priority, weight);
+}
+
+void EANSearch::SetCache(ResultCache * cache)
+{
+    this->cache = cache;
+}
+
+void EANSearch::SetSnapshot(const SnapshotIndex * snapshot, int page_size)
+{
+    this->snapshot = snapshot;
+    this->snapshot_page_size = page_size;
+}
+
+void EANSearch::SetProductIndex(const ProductIndex * index, int page_size)
+{
+    this->index = index;
+    this->index_page_size = page_size;
+}
+
+void EANSearch::SetSimilarityIndex(const SimilarityIndex * index, int page_size)
+{
+    this->similarity = index;
+    this->similarity_page_size = page_size;
+}
+
+void EANSearch::SetEndpoint(const string & host, const string & port)
+{
+    this->host = host;
+    this->port = port;
+    if (breaker) {
+        breaker->Reset();
+    }
+    if (budget) {
+        budget->Reset();
+    }
+}
+
+void EANSearch::SetCircuitBreaker(const BreakerPolicy & policy)
+{
+    delete breaker;
+    breaker = nullptr;
+    if (policy.error_rate > 0 || policy.slow_rate > 0) {
+        breaker = new CircuitBreaker(policy);
+    }
+}
+
+void EANSearch::SetConcurrencyLimit(const string & op, int limit)
+{
+    bulkhead->SetLimit(op, limit);
+}
+
+void EANSearch::SetCreditBudget(const BudgetPolicy & policy)
+{
+    delete budget;
+    budget = nullptr;
+    if (policy.throttle_at > 0) {
+        budget = new CreditBudget(policy);
+    }
+}
+
+BudgetStatus EANSearch::GetCreditBudget() const
+{
+    if (budget) {
+        return budget->Status();
+    }
+    BudgetStatus status;
+    status.remaining = remaining;
+    return status;
+}
+
+bool EANSearch::SetHttp2(int connections)
+{
+#ifdef EANSEARCH_HTTP2
+    delete http2;
+    this->http2 = connections > 0 ? new Http2Client(connections) : nullptr;
+    return true;
+#else
+    (void)connections;
+    return false;
+#endif
+}
+
+void EANSearch::SetTimeouts(const Timeouts & timeouts)
+{
+    this->timeouts = timeouts;
+}
+
+void EANSearch::SetPipelineDepth(int depth)
+{
+    this->pipeline_depth = max(depth, 1);
+}
+
+bool EANSearch::Query(const string & params, string & result)
+{
+    return APICall(params, result);
+}
+
+bool EANSearch::Query(const string & params, string & result, int & status)
+{
+    return APICall(params, result, 1, chrono::steady_clock::time_point::max(), &status);
+}
+
+/**
+ * @brief APICall() that answers from the attached cache if possible.
+ * @param params Query parameters (without token/format), also used as cache key.
+ * @param output Output parameter that receives the raw JSON response body.
+ * @return true on success, false on network/SSL/parse error.
+ */
+bool EANSearch::CachedAPICall(const string & params, string & output)
+{
+    if (cache) {
+        RequestTimer timer(metrics, OpOf(params));
+        if (cache->Get(params, output)) {
+            timer.Add(ClientMetrics::CacheHits);
+            return true;
+        }
+        timer.Add(ClientMetrics::CacheMisses);
+    }
+    if (!APICall(params, output)) {
+        return false;
+    }
+    if (cache) {
+        cache->Put(params, output);
+    }
+    return true;
+}
+
+int EANSearch::CachedQueryBatch(const vector<string> & params, vector<string> & results)
+{
+    if (!cache) {
+        return QueryBatch(params, results);
+    }
+    results.assign(params.size(), string());
+    vector<string> missed;
+    vector<size_t> positions; // of missed in params
+    int done = 0;
+    for (size_t i = 0; i < params.size(); i++) {
+        RequestTimer timer(metrics, OpOf(params[i]));
+        if (cache->Get(params[i], results[i])) {
+            timer.Add(ClientMetrics::CacheHits);
+            done++;
+            continue;
+        }
+        timer.Add(ClientMetrics::CacheMisses);
+        missed.push_back(params[i]);
+        positions.push_back(i);
+    }
+    vector<string> missed_results;
+    done += QueryBatch(missed, missed_results);
+    for (size_t j = 0; j < missed.size(); j++) {
+        if (!missed_results[j].empty()) {
+            cache->Put(missed[j], missed_results[j]);
+        }
+        results[positions[j]].swap(missed_results[j]);
+    }
+    return done;
+}
+
+/**
+ * @brief Time limits of a request: the timeouts of its phases, bounded by a deadline.
+ */
+struct Limits {
+    const Timeouts & timeouts;
+    chrono::steady_clock::time_point deadline;
+
+    /**
+     * @brief Time for a phase: its timeout or what's left until the deadline, whichever is less; zero for no limit.
+     *
+     * Throws a timeout error once the deadline has passed.
+     */
+    chrono::steady_clock::duration For(chrono::milliseconds timeout) const {
+        if (deadline == chrono::steady_clock::time_point::max()) {
+            return timeout;
+        }
+        auto left = deadline - chrono::steady_clock::now();
+        if (left <= chrono::steady_clock::duration::zero()) {
+            throw boost::system::system_error{beast::error::timeout};
+        }
+        return timeout.count() > 0 ? min<chrono::steady_clock::duration>(timeout, left) : left;
+    }
+};
+
+/**
+ * @brief Whether an exception reports an expired timeout.
+ */
+static bool IsTimeout(const std::exception & e) {
+    auto error = dynamic_cast<const boost::system::system_error *>(&e);
+    return error && (error->code() == beast::error::timeout || error->code() == net::error::timed_out);
+}
+
+/**
+ * @brief Limit the next operations on a connection, zero for no limit.
+ */
+static void Expire(Connection * c, chrono::steady_clock::duration timeout) {
+    auto & stream = beast::get_lowest_layer(c->stream);
+    if (timeout.count() > 0) {
+        stream.expires_after(timeout);
+    } else {
+        stream.expires_never();
+    }
+}
+
+/**
+ * @brief Start an asynchronous read or write on a connection and run it to completion.
+ * @return Bytes transferred.
+ *
+ * Only asynchronous operations observe the expiry set with Expire(), so
+ * the blocking calls are made this way on the connection's own io_context.
+ */
+template <class Operation>
+static size_t Await(Connection * c, beast::error_code & ec, Operation operation) {
+    size_t transferred = 0;
+    operation([&](beast::error_code e, size_t n) {
+        ec = e;
+        transferred = n;
+    });
+    c->ioc.restart();
+    c->ioc.run();
+    return transferred;
+}
+
+/**
+ * @brief Resolve, connect and handshake a new connection.
+ */
+static void Connect(Connection * c, ResolverCache & resolver, const Limits & limits, RequestTimer & timer) {
+    auto const host = c->host.c_str();
+    if (!SSL_set_tlsext_host_name(c->stream.native_handle(), host)) { // set SNI
+        boost::system::error_code ec{static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()};
+        throw boost::system::system_error{ec};
+    }
+    c->stream.set_verify_callback(ssl::host_name_verification(host));
+    auto const endpoints = resolver.Resolve(c->host, c->port);
+    timer.Mark(PhaseResolve);
+    HappyEyeballsConnect(c->ioc, endpoints, beast::get_lowest_layer(c->stream).socket(), limits.For(limits.timeouts.connect));
+    timer.Mark(PhaseConnect);
+    beast::error_code ec;
+    Expire(c, limits.For(limits.timeouts.handshake));
+    c->stream.async_handshake(ssl::stream_base::client, [&ec](beast::error_code e) { ec = e; });
+    c->ioc.restart();
+    c->ioc.run();
+    if (ec) {
+        throw boost::system::system_error{ec};
+    }
+    timer.Mark(PhaseHandshake);
+}
+
+/**
+ * @brief Read the next response on a connection and decode its body.
+ * @param output Receives the body; its buffer is handed to the parser and back, not copied.
+ * @param timeout Limit for the whole response, zero for none.
+ */
+static void ReadResponse(Connection * c, string & output, chrono::steady_clock::duration timeout,
+                         RequestTimer & timer, beast::error_code & ec) {
+    c->parser.emplace();
+    auto & body = c->parser->get().body();
+    body.swap(output);
+    body.clear();
+    Expire(c, timeout);
+    size_t received = Await(c, ec, [c](auto handler) { http::async_read_header(c->stream, c->buffer, *c->parser, handler); });
+    if (ec) {
+        return;
+    }
+    timer.Mark(PhaseFirstByte);
+    received += Await(c, ec, [c](auto handler) { http::async_read(c->stream, c->buffer, *c->parser, handler); });
+    if (ec) {
+        return;
+    }
+    timer.Mark(PhaseRead);
+    timer.Add(ClientMetrics::BytesReceived, received);
+    output.swap(body);
+    auto encoding = c->parser->get()[http::field::content_encoding];
+    if (!encoding.empty()) {
+        // both buffers keep their capacity for the next response
+        c->encoded.swap(output);
+        if (!c->decompressor.Decompress(string_view(encoding.data(), encoding.size()), c->encoded, output)) {
+            ec = http::error::bad_transfer_encoding;
+        }
+    }
+}
+
+/**
+ * @brief Send one request on a connection and read the response.
+ */
+static void Exchange(Connection * c, const string & target, string & output, const Limits & limits,
+                     RequestTimer & timer, beast::error_code & ec) {
+    c->req.target(target);
+    c->requests++;
+    Expire(c, limits.For(limits.timeouts.write));
+    timer.Add(ClientMetrics::BytesSent, Await(c, ec, [c](auto handler) { http::async_write(c->stream, c->req, handler); }));
+    if (ec) {
+        return;
+    }
+    timer.Mark(PhaseWrite);
+    ReadResponse(c, output, limits.For(limits.timeouts.read), timer, ec);
+}
+
+/**
+ * @brief Send a request on a kept-alive HTTP/1.1 connection from the pool.
+ * @param credits Receives the X-Credits-Remaining header.
+ * @param slot Lets another thread cancel the request, optional.
+ * @return HTTP status; throws on network errors.
+ */
+static int PooledGet(ConnectionPool * pool, const string & host, const string & port, const string & target,
+                     string & output, string & credits, const Limits & limits, RequestTimer & timer,
+                     CancelSlot * slot = nullptr) {
+    Connection * c = pool->Acquire(host, port);
+    bool reused = c != nullptr;
+    for (;;) {
+        beast::error_code ec;
+        bool cancelled = false;
+        try {
+            if (!c) {
+                c = pool->Create(host, port);
+                Connect(c, pool->resolver, limits, timer);
+            }
+            if (slot && !slot->Attach(c)) {
+                ec = net::error::operation_aborted;
+            } else {
+                Exchange(c, target, output, limits, timer, ec);
+            }
+            cancelled = slot && slot->Detach();
+        }
+        catch(...) {
+            if (c) {
+                if (slot) {
+                    slot->Detach();
+                }
+                pool->Release(c, false);
+            }
+            throw;
+        }
+        if (!ec && !cancelled) {
+            break;
+        }
+        pool->Release(c, false);
+        c = nullptr;
+        if (!reused || cancelled) {
+            throw boost::system::system_error{ec ? ec : net::error::operation_aborted};
+        }
+        // the server may close an idle connection at any time, try once more on a new one
+        reused = false;
+    }
+    auto & res = c->parser->get();
+    auto header = res.base()["X-Credits-Remaining"];
+    credits.assign(header.data(), header.size());
+    int status = res.result_int();
+    pool->Release(c, res.keep_alive());
+    return status;
+}
+
+/**
+ * @brief Send a request on a pooled connection, and a second one on another connection if it is slow.
+ * @return HTTP status of the first answer; throws if neither request got one.
+ */
+static int HedgedGet(Hedger * hedger, ConnectionPool * pool, const string & host, const string & port, const string & target,
+                     string & output, string & credits, const Limits & limits, RequestTimer & timer) {
+    auto call = make_shared<HedgedCall>();
+    call->target = target;
+    call->deadline = limits.deadline;
+    auto start = chrono::steady_clock::now();
+    hedger->Schedule(call);
+    int status = 0;
+    exception_ptr error;
+    try {
+        status = PooledGet(pool, host, port, target, output, credits, limits, timer, &call->primary);
+    }
+    catch(...) {
+        error = current_exception();
+    }
+    if (hedger->Settle(*call, !error)) {
+        // the first request was cancelled, or its response is discarded
+        timer.Add(ClientMetrics::HedgeWins);
+        status = call->status;
+        output.swap(call->output);
+        credits.swap(call->credits);
+        // the latency of a single request, the delay would feed back into the percentile otherwise
+        hedger->Record(call->latency);
+    } else if (error) {
+        rethrow_exception(error);
+    } else if (status == 200) {
+        hedger->Record(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start));
+    }
+    return status;
+}
+
+#ifdef EANSEARCH_HTTP2
+/**
+ * @brief Send a request as a stream on a shared HTTP/2 connection.
+ * @return HTTP status, -1 if the server doesn't support HTTP/2; throws on network errors.
+ */
+static int MultiplexedGet(Http2Client * http2, const string & host, const string & port, const string & target,
+                          string & output, string & credits, const Limits & limits, RequestTimer & timer) {
+    thread_local Http2Response res;
+    auto & t = limits.timeouts;
+    // the request is a single frame, so the read timeout covers the whole stream
+    Http2Timeouts timeouts { limits.For(t.connect), limits.For(t.handshake), limits.For(t.read) };
+    res.body.swap(output);
+    bool multiplexed;
+    try {
+        multiplexed = http2->Get(host, port, target, res, timeouts, timer);
+    }
+    catch(...) {
+        output.swap(res.body);
+        throw;
+    }
+    output.swap(res.body);
+    credits.swap(res.credits);
+    return multiplexed ? res.status : -1;
+}
+#endif
+
 /**
  * @brief Perform a synchronous HTTPS GET request to the API.
  * @param params Query parameters (without token/format).
  * @param result Output parameter that receives the raw JSON response body.
  * @return true on success, false on network/SSL/parse error.
  */
-bool EANSearch::APICall(const string & params, string & output, int tries)
+bool EANSearch::APICall(const string & params, string & output, int tries, chrono::steady_clock::time_point deadline, int * http_status)
 {
-    auto const host = "api.ean-search.org";
-    auto const port = "443";
-    auto const version = 11;
-    string target = "/api?" + params + "&token=" + this->token + "&format=json";
+    if (http_status) {
+        *http_status = 0;
+    }
+    if (tries == 1 && timeouts.call.count() > 0) {
+        deadline = chrono::steady_clock::now() + timeouts.call;
+    }
+    // a buffer of its own, params usually live in the RequestParams() buffer
+    thread_local string target;
+    target.assign("/api?");
+    target += params;
+    target += suffix;
 
+    string_view op = OpOf(params);
+    RequestTimer timer(metrics, op);
+    // retries belong to the call that entered the bulkhead
+    int op_index = ClientMetrics::OpIndex(op);
+    if (tries == 1 && !bulkhead->Enter(op_index)) {
+        cerr << "Error: too many concurrent " << op << " calls" << std::endl;
+        timer.Add(ClientMetrics::Rejected);
+        return false;
+    }
+    BulkheadGuard entered(tries == 1 ? bulkhead : nullptr, op_index);
+    if (tries == 1 && budget && !budget->Admit(ScopedPriority::Current(), deadline)) {
+        cerr << "Error: credit budget of the month exceeded, " << op << " call refused" << std::endl;
+        timer.Add(ClientMetrics::Rejected);
+        return false;
+    }
+    if (breaker && !breaker->Allow()) {
+        cerr << "Error: circuit open for " << host << ", failing fast" << std::endl;
+        timer.Add(ClientMetrics::Rejected);
+        return false;
+    }
+    timer.Add(ClientMetrics::Requests);
+    if (tries > 1) {
+        timer.Add(ClientMetrics::Retries);
+    }
+    auto waited = scheduler->Acquire(ScopedPriority::Current(), deadline);
+    if (waited.count() < 0) {
+        if (breaker) {
+            breaker->Abandon();
+        }
+        cerr << "Error: the request couldn't be sent before its deadline" << std::endl;
+        timer.Add(ClientMetrics::Errors);
+        timer.Add(ClientMetrics::TimedOut);
+        return false;
+    }
+    SchedulerSlot slot(scheduler);
+    metrics.RecordRateLimitWait(waited.count());
+    timer.Restart(); // waiting for the rate limit is not part of the request
+    metrics.AddInFlight(1);
+    InFlightGuard in_flight(metrics);
+    auto sent = chrono::steady_clock::now();
     try {
-        net::io_context ioc;
-        ssl::context ctx(ssl::context::tlsv12_client);
-        tcp::resolver resolver(ioc);
-        ssl::stream<beast::tcp_stream> stream(ioc, ctx);
-        if (!SSL_set_tlsext_host_name(stream.native_handle(), host)) { // set SNI
-            boost::system::error_code ec{static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()};
-            throw boost::system::system_error{ec};
-        }
-        stream.set_verify_callback(ssl::host_name_verification(host));
-        auto const results = resolver.resolve(host, port);
-        beast::get_lowest_layer(stream).connect(results);
-        stream.handshake(ssl::stream_base::client);
-        http::request<http::string_body> req{http::verb::get, target, version};
-        req.set(http::field::host, host);
-        req.set(http::field::user_agent, "cpp-eansearch/1.0");
-        http::write(stream, req);
-        beast::flat_buffer buffer;
-        http::response<http::string_body> res;
-        http::read(stream, buffer, res);
-        output = res.body();
-        beast::error_code ec;
-        stream.shutdown(ec);
-        if (ec == boost::asio::error::eof) {
-            ec.assign(0, ec.category());
+        Limits limits { timeouts, deadline };
+        thread_local string credits;
+        int status = -1;
+#ifdef EANSEARCH_HTTP2
+        if (http2) {
+            status = MultiplexedGet(http2, host, port, target, output, credits, limits, timer);
+        }
+#endif
+        if (status < 0 && hedger && OpOf(params) == "barcode-lookup") {
+            status = HedgedGet(hedger, pool, host, port, target, output, credits, limits, timer);
+        }
+        if (status < 0) {
+            status = PooledGet(pool, host, port, target, output, credits, limits, timer);
+        }
+        int value;
+        // a response without the header is still a success, only the credits stay unknown
+        if (status == 200 && from_chars(credits.data(), credits.data() + credits.size(), value).ec == errc()) {
+            remaining = value;
+            if (budget) {
+                budget->Record(op_index, value);
+            }
+        }
+        timer.Total();
+        timer.Status(status);
+        if (http_status) {
+            *http_status = status;
         }
-        if (ec) {
-            throw boost::system::system_error{ec};
+        if (breaker) {
+            breaker->Record(status >= 500, chrono::steady_clock::now() - sent);
         }
-		if (res.result_int() == 429 && tries <= MAX_API_TRIES) {
-			this_thread::sleep_for(chrono::milliseconds(1000));
-			return APICall(params, output, tries+1);
+		if (status == 429 && tries <= MAX_API_TRIES) {
+			auto backoff = Backoff(tries);
+			if (deadline - chrono::steady_clock::now() > backoff) {
+				slot.Release(); // the retry waits for a slot of its own
+				this_thread::sleep_for(backoff);
+				return APICall(params, output, tries+1, deadline, http_status);
+			}
 		}
-		if (res.result_int() != 200) {
+		if (status != 200) {
 			return false;
-		} else {
-			remaining = stoi(res.base()["X-Credits-Remaining"]);
 		}
     }
     catch(std::exception const & e) {
         cerr << "Error: " << e.what() << std::endl;
+        timer.Add(ClientMetrics::Errors);
+        if (IsTimeout(e)) {
+            timer.Add(ClientMetrics::TimedOut);
+        }
+        if (breaker) {
+            breaker->Record(true, chrono::steady_clock::now() - sent);
+        }
         return false;
     }
     return true;
 }
 
+void EANSearch::SetHedging(double percentile, double max_extra_percent)
+{
+    delete hedger;
+    hedger = nullptr;
+    if (percentile <= 0) {
+        return;
+    }
+    hedger = new Hedger(percentile, max_extra_percent, [this](HedgedCall & call, int & status, string & output, string & credits) {
+        // a hedge is only worth it if it goes out right away
+        if (!scheduler->TryAcquire()) {
+            return false;
+        }
+        SchedulerSlot slot(scheduler);
+        RequestTimer timer(metrics, "barcode-lookup");
+        timer.Add(ClientMetrics::Requests);
+        timer.Add(ClientMetrics::Hedges);
+        metrics.AddInFlight(1);
+        InFlightGuard in_flight(metrics);
+        try {
+            status = PooledGet(pool, host, port, call.target, output, credits, Limits { timeouts, call.deadline }, timer, &call.hedge);
+            timer.Total();
+            timer.Status(status);
+        }
+        catch(std::exception const & e) {
+            if (!call.hedge.Cancelled()) {
+                timer.Add(ClientMetrics::Errors);
+                if (IsTimeout(e)) {
+                    timer.Add(ClientMetrics::TimedOut);
+                }
+            }
+            throw;
+        }
+        return true;
+    });
+}
+
 /**
- * @brief Percent-encode a string for use in URL query components (RFC 3986).
- * @param str Input string to encode.
- * @return Encoded string where non-unreserved characters are percent-encoded.
+ * @brief Append a GET request for target with the headers of the connection's request.
  */
-string EANSearch::urlencode(const string & str) {
-    // RFC 3986 percent-encoding for query components: unreserved characters remain unencoded
-    // unreserved = ALPHA / DIGIT / "-" / "." / "_" / "~"
-    static const char * hex = "0123456789ABCDEF";
-    string out;
-    out.reserve(str.size() * 3);
-
-    for (unsigned char c : str) {
-        if ( (c >= 'A' && c <= 'Z') ||
-             (c >= 'a' && c <= 'z') ||
-             (c >= '0' && c <= '9') ||
-             c == '-' || c == '_' || c == '.' || c == '~' ) {
-            out.push_back(static_cast<char>(c));
-        } else {
-            out.push_back('%');
-            out.push_back(hex[(c >> 4) & 0xF]);
-            out.push_back(hex[c & 0xF]);
+static void AppendRequest(string & wire, Connection * c, const string & target) {
+    wire += "GET ";
+    wire += target;
+    wire += " HTTP/1.1\r\n";
+    for (auto const & field : c->req) {
+        wire.append(field.name_string().data(), field.name_string().size());
+        wire += ": ";
+        wire.append(field.value().data(), field.value().size());
+        wire += "\r\n";
+    }
+    wire += "\r\n";
+}
+
+int EANSearch::QueryBatch(const vector<string> & params, vector<string> & results)
+{
+    results.assign(params.size(), string());
+    vector<size_t> todo(params.size());
+    iota(todo.begin(), todo.end(), 0);
+    auto deadline = chrono::steady_clock::time_point::max();
+    if (timeouts.batch.count() > 0) {
+        deadline = chrono::steady_clock::now() + timeouts.batch;
+    }
+    int done = 0;
+    for (int tries = 1; !todo.empty(); tries++) {
+        vector<size_t> throttled;
+        done += Pipeline(params, todo, tries, deadline, results, throttled);
+        auto backoff = Backoff(tries);
+        if (throttled.empty() || tries > MAX_API_TRIES || deadline - chrono::steady_clock::now() <= backoff) {
+            break;
+        }
+        this_thread::sleep_for(backoff);
+        todo.swap(throttled);
+    }
+    return done;
+}
+
+/**
+ * @brief Send requests pipelined on one connection at a time.
+ * @param todo Indexes of the requests to send.
+ * @param tries 1 for the first attempt, more for requests sent again after a 429.
+ * @param deadline Requests without a response by then fail.
+ * @param throttled Receives the indexes of the requests answered with 429.
+ * @return Number of successful requests.
+ *
+ * Up to pipeline_depth requests are in flight; the next ones are written
+ * together whenever a response has been read. Requests without a response
+ * when the connection fails or closes are sent again on a new one, which
+ * is safe as all API requests are idempotent GETs.
+ */
+int EANSearch::Pipeline(const vector<string> & params, const vector<size_t> & todo, int tries,
+                        chrono::steady_clock::time_point deadline, vector<string> & results, vector<size_t> & throttled)
+{
+    struct Request {
+        size_t index;
+        RequestTimer timer;
+        chrono::steady_clock::time_point sent;
+    };
+    // indexes to send, and whether they have been sent before
+    deque<pair<size_t, bool>> queue;
+    for (size_t i : todo) {
+        queue.emplace_back(i, tries > 1);
+    }
+    deque<Request> in_flight;
+    thread_local string wire;
+    string target;
+    int done = 0;
+    int failures = 0; // connections in a row that failed before a response
+    Limits limits { timeouts, deadline };
+    bool out_of_time = false;
+    Priority priority = ScopedPriority::Current();
+    while (!queue.empty()) {
+        if (breaker && !breaker->Allow()) {
+            cerr << "Error: circuit open for " << host << ", failing fast" << std::endl;
+            for (auto & q : queue) {
+                RequestTimer timer(metrics, OpOf(params[q.first]));
+                timer.Add(ClientMetrics::Rejected);
+            }
+            break;
+        }
+        // each request written takes an Allow() of its own, so a pipeline can't
+        // send more than the trial requests of a half-open breaker; this one is
+        // for the first request, or for the connect if that fails
+        bool allowed = breaker != nullptr;
+        Connection * c = pool->Acquire(host, port);
+        bool keep_alive = true;
+        bool wrote = false;
+        bool connecting = false;
+        try {
+            if (!c) {
+                c = pool->Create(host, port);
+                RequestTimer timer(metrics, OpOf(params[queue.front().first]));
+                connecting = true;
+                Connect(c, pool->resolver, limits, timer);
+                connecting = false;
+            }
+            while (keep_alive && (!queue.empty() || !in_flight.empty())) {
+                wire.clear();
+                size_t written = in_flight.size();
+                while (!queue.empty() && (int)in_flight.size() < pipeline_depth) {
+                    if (breaker && !allowed) {
+                        if (!breaker->Allow()) {
+                            break; // half-open, wait for the answers to the trial requests in flight
+                        }
+                        allowed = true;
+                    }
+                    if (!queue.front().second && budget && !budget->Admit(priority, deadline)) {
+                        cerr << "Error: credit budget of the month exceeded, batch refused" << std::endl;
+                        for (auto & q : queue) {
+                            RequestTimer timer(metrics, OpOf(params[q.first]));
+                            timer.Add(ClientMetrics::Rejected);
+                        }
+                        queue.clear();
+                        break;
+                    }
+                    chrono::microseconds waited(0);
+                    if (in_flight.empty()) {
+                        waited = scheduler->Acquire(priority, deadline);
+                        if (waited.count() < 0) {
+                            out_of_time = true;
+                            throw boost::system::system_error{beast::error::timeout};
+                        }
+                    } else if (!scheduler->TryAcquire()) {
+                        // waiting here could wait for the requests in flight, read their responses first
+                        break;
+                    }
+                    auto [i, replay] = queue.front();
+                    queue.pop_front();
+                    RequestTimer timer(metrics, OpOf(params[i]));
+                    timer.Add(ClientMetrics::Requests);
+                    if (replay) {
+                        timer.Add(ClientMetrics::Retries);
+                    }
+                    metrics.RecordRateLimitWait(waited.count());
+                    timer.Restart();
+                    metrics.AddInFlight(1);
+                    target.assign("/api?");
+                    target += params[i];
+                    target += suffix;
+                    size_t size = wire.size();
+                    AppendRequest(wire, c, target);
+                    timer.Add(ClientMetrics::BytesSent, wire.size() - size);
+                    in_flight.push_back(Request { i, timer, chrono::steady_clock::now() });
+                    allowed = false;
+                    c->requests++;
+                }
+                if (!wire.empty()) {
+                    wrote = true;
+                    beast::error_code ec;
+                    Expire(c, limits.For(timeouts.write));
+                    Await(c, ec, [c](auto handler) { net::async_write(c->stream, net::buffer(wire), handler); });
+                    if (ec) {
+                        throw boost::system::system_error{ec};
+                    }
+                    for (size_t n = written; n < in_flight.size(); n++) {
+                        in_flight[n].timer.Mark(PhaseWrite);
+                    }
+                }
+                if (in_flight.empty()) {
+                    break; // the rest was refused, by the budget or the breaker
+                }
+                Request & r = in_flight.front();
+                beast::error_code ec;
+                ReadResponse(c, results[r.index], limits.For(timeouts.read), r.timer, ec);
+                if (ec) {
+                    throw boost::system::system_error{ec};
+                }
+                failures = 0;
+                auto & res = c->parser->get();
+                int status = res.result_int();
+                keep_alive = res.keep_alive();
+                r.timer.Total();
+                r.timer.Status(status);
+                metrics.AddInFlight(-1);
+                scheduler->Release();
+                if (breaker) {
+                    breaker->Record(status >= 500, chrono::steady_clock::now() - r.sent);
+                }
+                if (status == 200) {
+                    auto credits = res.base()["X-Credits-Remaining"];
+                    int value;
+                    if (from_chars(credits.data(), credits.data() + credits.size(), value).ec == errc()) {
+                        remaining = value;
+                        if (budget) {
+                            budget->Record(ClientMetrics::OpIndex(OpOf(params[r.index])), value);
+                        }
+                    }
+                    done++;
+                } else {
+                    if (status == 429) {
+                        throttled.push_back(r.index);
+                    }
+                    results[r.index].clear();
+                }
+                in_flight.pop_front();
+            }
+            pool->Release(c, keep_alive);
+            if (allowed) {
+                breaker->Abandon(); // refused, the allowed request never went out
+            }
+        }
+        catch(std::exception const & e) {
+            if (c) {
+                pool->Release(c, false);
+            }
+            if (breaker) {
+                // only a failed connect, write or read tells something about the server,
+                // not a deadline that passed while the batch waited in its own queue;
+                // the connection counts as one failure, the other allowed requests are given back
+                int unrecorded = allowed + (int)in_flight.size();
+                if (unrecorded > 0 && !out_of_time && (connecting || wrote)) {
+                    breaker->Record(true, chrono::steady_clock::duration::zero());
+                    unrecorded--;
+                }
+                for (; unrecorded > 0; unrecorded--) {
+                    breaker->Abandon();
+                }
+            }
+            // the batch ends when its deadline has passed, a timeout of one phase only loses the connection
+            bool expired = out_of_time || chrono::steady_clock::now() >= deadline;
+            if (expired || ++failures > MAX_API_TRIES) {
+                cerr << "Error: " << e.what() << std::endl;
+                for (auto & r : in_flight) {
+                    r.timer.Add(ClientMetrics::Errors);
+                    if (expired) {
+                        r.timer.Add(ClientMetrics::TimedOut);
+                    }
+                    metrics.AddInFlight(-1);
+                    scheduler->Release();
+                }
+                for (auto & q : queue) {
+                    RequestTimer timer(metrics, OpOf(params[q.first]));
+                    timer.Add(ClientMetrics::Errors);
+                    if (expired) {
+                        timer.Add(ClientMetrics::TimedOut);
+                    }
+                }
+                break;
+            }
+        }
+        // the pipeline broke, send the requests without a response again
+        for (auto r = in_flight.rbegin(); r != in_flight.rend(); ++r) {
+            metrics.AddInFlight(-1);
+            scheduler->Release();
+            queue.emplace_front(r->index, true);
+        }
+        in_flight.clear();
+    }
+    return done;
+}
+
+/// Characters left as they are by urlencode(): ALPHA / DIGIT / "-" / "." / "_" / "~"
+static const array<bool, 256> UNRESERVED = []() {
+    array<bool, 256> table {};
+    for (int c = 0; c < 256; c++) {
+        table[c] = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+            || c == '-' || c == '_' || c == '.' || c == '~';
+    }
+    return table;
+}();
+
+#ifdef __SSE2__
+/**
+ * @brief Bit mask of the unreserved bytes among 16 bytes.
+ *
+ * Each range test lo <= c <= hi is one signed comparison after shifting
+ * lo to -128.
+ */
+static inline int UnreservedMask(const char * p) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    auto in_range = [](__m128i c, char lo, char hi) {
+        return _mm_cmplt_epi8(_mm_add_epi8(c, _mm_set1_epi8((char)(0x80 - lo))), _mm_set1_epi8((char)(0x80 + hi - lo + 1)));
+    };
+    __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20)); // letters of both cases
+    __m128i ok = _mm_or_si128(_mm_or_si128(in_range(lower, 'a', 'z'), in_range(c, '0', '9')),
+        _mm_or_si128(in_range(c, '-', '.'), _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('_')), _mm_cmpeq_epi8(c, _mm_set1_epi8('~')))));
+    return _mm_movemask_epi8(ok);
+}
+#endif
+
+#ifdef __AVX2__
+/**
+ * @brief Bit mask of the unreserved bytes among 32 bytes, see UnreservedMask().
+ */
+static inline uint32_t UnreservedMask32(const char * p) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    auto in_range = [](__m256i c, char lo, char hi) {
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + hi - lo + 1)), _mm256_add_epi8(c, _mm256_set1_epi8((char)(0x80 - lo))));
+    };
+    __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    __m256i ok = _mm256_or_si256(_mm256_or_si256(in_range(lower, 'a', 'z'), in_range(c, '0', '9')),
+        _mm256_or_si256(in_range(c, '-', '.'), _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')),
+                                                                 _mm256_cmpeq_epi8(c, _mm256_set1_epi8('~')))));
+    return _mm256_movemask_epi8(ok);
+}
+#endif
+
+/**
+ * @brief Length of the run of unreserved bytes at the start of [p, end).
+ */
+static inline size_t UnreservedRun(const char * p, const char * end) {
+    const char * q = p;
+#ifdef __AVX2__
+    while (end - q >= 32) {
+        uint32_t mask = UnreservedMask32(q);
+        if (mask != 0xFFFFFFFFu) {
+            return q - p + __builtin_ctz(~mask);
+        }
+        q += 32;
+    }
+#endif
+#ifdef __SSE2__
+    while (end - q >= 16) {
+        int mask = UnreservedMask(q);
+        if (mask != 0xFFFF) {
+            return q - p + __builtin_ctz(~mask);
         }
+        q += 16;
     }
+#endif
+    while (q < end && UNRESERVED[(unsigned char)*q]) {
+        q++;
+    }
+    return q - p;
+}
+
+string urlencode(const string & str) {
+    string out;
+    urlencode(str, out);
     return out;
 }
 
-ProductList * EANSearch::ParseProductList(const string & str) {
+/**
+ * Runs of unreserved characters are found 16 or 32 bytes at a time and
+ * copied in one piece; escapes are written into space reserved up front.
+ */
+void urlencode(const string & str, string & out) {
+    static const char * hex = "0123456789ABCDEF";
+    size_t start = out.size();
+    out.resize(start + str.size() * 3);
+    char * o = &out[start];
+    const char * p = str.data();
+    const char * end = p + str.size();
+    while (p < end) {
+        size_t run = UnreservedRun(p, end);
+        memcpy(o, p, run);
+        o += run;
+        p += run;
+        while (p < end && !UNRESERVED[(unsigned char)*p]) {
+            unsigned char c = *p++;
+            o[0] = '%';
+            o[1] = hex[c >> 4];
+            o[2] = hex[c & 0xF];
+            o += 3;
+        }
+    }
+    out.resize(o - out.data());
+}
+
+ProductList * ParseProductList(const string & str) {
     error_code ec;
     auto api_result = json::parse(str, ec);
     json::array * arr = nullptr;
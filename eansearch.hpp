@@ -12,10 +12,41 @@
 
 #include <string>
 #include <list>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include "eansearch_metrics.hpp"
 using namespace std;
 
 
 const int MAX_API_TRIES = 3;
+/// First wait before a request throttled with status 429 is sent again, it doubles with each try
+const int BACKOFF_BASE_MS = 500;
+/// Longest wait before a throttled request is sent again
+const int BACKOFF_MAX_MS = 8000;
+
+/**
+ * @brief Time limits of API requests, zero for no limit.
+ *
+ * Each phase of a request has its own limit, and the call limit bounds
+ * all of them together, with retries and waiting for the rate limiter.
+ * A request that runs out of time fails like one with a network error.
+ */
+struct Timeouts {
+    /// TCP connect, all attempts on the addresses of the server together
+    chrono::milliseconds connect { 10000 };
+    /// TLS handshake
+    chrono::milliseconds handshake { 10000 };
+    /// Writing a request
+    chrono::milliseconds write { 10000 };
+    /// Reading a response; with HTTP/2 it limits the whole stream
+    chrono::milliseconds read { 30000 };
+    /// Each method call
+    chrono::milliseconds call { 0 };
+    /// Each QueryBatch() or BatchBarcodeLookup(), requests still outstanding then fail
+    chrono::milliseconds batch { 0 };
+};
 
 /**
  * @brief Basic product information.
@@ -82,11 +113,81 @@ enum Language {
     Any = 99
 };
 
+/**
+ * @brief Priority classes of API requests, see ScopedPriority.
+ */
+enum Priority {
+    PriorityInteractive,
+    PriorityNormal,
+    PriorityBatch
+};
+const int PRIORITY_COUNT = 3;
+
+/**
+ * @brief Sets the priority of the API requests this thread makes while it is in scope.
+ *
+ * Requests are PriorityNormal unless set. When requests have to wait for
+ * the rate limit or the limit of requests in flight, higher classes go
+ * first, see EANSearch::SetPriorityWeight().
+ */
+class ScopedPriority {
+public:
+    ScopedPriority(Priority priority);
+    ~ScopedPriority();
+
+    /// Priority of the requests of this thread
+    static Priority Current();
+
+private:
+    Priority previous;
+};
+
+class SnapshotIndex;
+class ProductIndex;
+class SimilarityIndex;
+class ConnectionPool;
+class Http2Client;
+class Hedger;
+class CircuitBreaker;
+class Bulkhead;
+struct BreakerPolicy;
+class CreditBudget;
+struct BudgetPolicy;
+struct BudgetStatus;
+class RequestScheduler;
+
+/**
+ * @brief Interface for caches of API responses.
+ *
+ * Keys are the query parameters of a request, values the raw JSON
+ * response. Implementations must be thread-safe.
+ */
+class ResultCache {
+public:
+    virtual ~ResultCache() { };
+
+    /**
+     * @brief Lookup a cached response.
+     * @param key Query parameters of the request.
+     * @param value Receives the cached response.
+     * @return true if a fresh entry was found.
+     */
+    virtual bool Get(const string & key, string & value) = 0;
+
+    /**
+     * @brief Store a response.
+     * @param key Query parameters of the request.
+     * @param value Raw JSON response.
+     */
+    virtual void Put(const string & key, const string & value) = 0;
+};
+
 /**
  * @brief Main class to interact with the API.
  *
  * Construct with a valid API token. Methods perform synchronous HTTP(S)
  * requests and return either result objects or null/empty values on error.
+ * Methods may be called from several threads at once.
  */
 class EANSearch
 {
@@ -96,6 +197,7 @@ public:
      * @param token API token string used for all requests.
      */
     EANSearch(const string & token);
+    ~EANSearch();
 
     /**
      * @brief Lookup a single barcode (EAN/GTIN/UPC/ISBN-13).
@@ -105,6 +207,16 @@ public:
      */
     ProductFull * BarcodeLookup(const string & ean, int language = English);
 
+    /**
+     * @brief Lookup several barcodes, see BarcodeLookup().
+     * @param eans Barcodes to lookup.
+     * @param language Preferred language for the product names (optional).
+     * @return One product per barcode, nullptr if not found or on failure.
+     *
+     * Barcodes that aren't in the snapshot or cache are sent with QueryBatch().
+     */
+    vector<ProductFull *> BatchBarcodeLookup(const vector<string> & eans, int language = English);
+
     /**
      * @brief Lookup an ISBN (ISBN-10).
      * @param isbn ISBN-10 string.
@@ -186,14 +298,249 @@ public:
      */
 	int CreditsRemaining();
 
+    /**
+     * @brief Limit the rate of requests sent to the API.
+     * @param requests_per_second Maximum request rate (0 = unlimited).
+     * @param burst Number of requests that may be sent back to back.
+     *
+     * The limit is shared by all threads using this object. Requests that
+     * have to wait are served by priority, see ScopedPriority.
+     */
+    void SetRateLimit(double requests_per_second, int burst = 1);
+
+    /**
+     * @brief Limit the requests in flight, and so the connections to the API.
+     * @param requests Requests at a time, 0 for no limit (default).
+     *
+     * Requests that have to wait are served by priority, see ScopedPriority.
+     */
+    void SetMaxInFlight(int requests);
+
+    /**
+     * @brief Set the share of the waiting requests of a priority class that go first.
+     * @param priority Class, see ScopedPriority.
+     * @param weight Share relative to the other classes (defaults 16, 4 and 1).
+     *
+     * With all classes waiting, interactive requests get 16 of 21 turns and
+     * batch requests still 1, so batch jobs use the spare capacity without
+     * delaying interactive calls much.
+     */
+    void SetPriorityWeight(Priority priority, double weight);
+
+    /**
+     * @brief Get request counters and latency histograms per operation.
+     * @return Metrics of all operations; no operations if compiled with EANSEARCH_NO_METRICS.
+     *
+     * Latencies are recorded per phase of a request: resolve, connect,
+     * TLS handshake, write, first byte, read and JSON parsing, plus the total.
+     */
+    MetricsSnapshot GetMetrics() const;
+
+    /**
+     * @brief Attach a cache for barcode and issuing country lookups.
+     * @param cache Cache to use (not owned), nullptr to detach.
+     *
+     * Cached lookups don't use credits; they don't update CreditsRemaining() either.
+     */
+    void SetCache(ResultCache * cache);
+
+    /**
+     * @brief Answer barcode lookups and prefix searches from a local product snapshot first.
+     * @param snapshot Snapshot index (not owned), nullptr to detach.
+     * @param page_size Products per page of a prefix search, as returned by the API.
+     *
+     * Barcodes not in the snapshot, prefixes the snapshot doesn't hold
+     * completely and requests in another language than the one of the
+     * snapshot go to the API.
+     */
+    void SetSnapshot(const SnapshotIndex * snapshot, int page_size = 10);
+
+    /**
+     * @brief Answer product and category searches from a local index first.
+     * @param index Index over the products of a snapshot (not owned), nullptr to detach.
+     * @param page_size Products per page of a search, as returned by the API.
+     *
+     * Searches without a match in the index, or for another language than
+     * the one of the index, go to the API.
+     */
+    void SetProductIndex(const ProductIndex * index, int page_size = 10);
+
+    /**
+     * @brief Answer similar product searches from a local index first.
+     * @param index Similarity index over the products of a snapshot (not owned), nullptr to detach.
+     * @param page_size Products per page of a search, as returned by the API.
+     *
+     * Searches without a similar product in the index, or for another
+     * language than the one of the index, go to the API.
+     */
+    void SetSimilarityIndex(const SimilarityIndex * index, int page_size = 10);
+
+    /**
+     * @brief Send requests to another server, e.g. a mock or a TLS-terminating proxy.
+     * @param host Host name (default api.ean-search.org).
+     * @param port Port (default 443).
+     *
+     * Requests always use TLS, so the server must speak HTTPS. eansearchd
+     * serves plain HTTP and can't be used as the endpoint.
+     */
+    void SetEndpoint(const string & host, const string & port = "443");
+
+    /**
+     * @brief Limit the time of requests, calls and batches.
+     * @param timeouts Limits, see Timeouts for the defaults.
+     *
+     * Call it before making requests, it isn't synchronized with them.
+     */
+    void SetTimeouts(const Timeouts & timeouts);
+
+    /**
+     * @brief Multiplex requests over HTTP/2 connections instead of one HTTP/1.1 connection per request.
+     * @param connections Connections to the server, 0 to go back to HTTP/1.1.
+     * @return false if the library was built without EANSEARCH_HTTP2.
+     *
+     * Servers that don't negotiate HTTP/2 are still reached with HTTP/1.1.
+     * Call it before making requests, it isn't synchronized with them.
+     */
+    bool SetHttp2(int connections = 1);
+
+    /**
+     * @brief Send a second request for BarcodeLookup() calls that are slower than usual.
+     * @param percentile Percentile of recent latencies after which the second request goes out, 0 to turn hedging off.
+     * @param max_extra_percent Second requests as a percentage of the calls at most, each costs a credit.
+     *
+     * The second request is sent on another pooled connection; the first
+     * answer wins and the other request is cancelled. Calls sent over
+     * HTTP/2 are not hedged. Call it before making requests, it isn't
+     * synchronized with them.
+     */
+    void SetHedging(double percentile = 95, double max_extra_percent = 5);
+
+    /**
+     * @brief Fail requests fast while the server is failing, see CircuitBreaker.
+     * @param policy Error and slow rates that open the circuit (eansearch_breaker.hpp); both 0 turn the breaker off.
+     *
+     * Failures are network errors, timeouts and 5xx responses. While the
+     * circuit is open, calls return an error without connecting. The
+     * breaker belongs to the endpoint, SetEndpoint() closes it again. Call
+     * it before making requests, it isn't synchronized with them.
+     */
+    void SetCircuitBreaker(const BreakerPolicy & policy);
+
+    /**
+     * @brief Cap the concurrent calls of an API operation; calls beyond it fail right away.
+     * @param op Operation name from METRICS_OPS, e.g. "similar-product-search".
+     * @param limit Concurrent calls, 0 for no cap (default).
+     *
+     * A slow operation then can't take all threads and connections from the others.
+     */
+    void SetConcurrencyLimit(const string & op, int limit);
+
+    /**
+     * @brief Spread the credits left over the rest of the month, see CreditBudget.
+     * @param policy When to throttle (eansearch_budget.hpp); throttle_at 0 turns the budget off.
+     *
+     * When everybody using the token, at the rate of the last hour, would
+     * use up the credits before the end of the month, batch calls fail
+     * right away and normal calls are slowed down; interactive calls go
+     * out as usual, see ScopedPriority. Call it before making requests, it
+     * isn't synchronized with them.
+     */
+    void SetCreditBudget(const BudgetPolicy & policy);
+
+    /**
+     * @brief Get the credits used per operation and caller tag, and the projection to the end of the month.
+     * @return Status of the budget, only the remaining credits without one.
+     */
+    BudgetStatus GetCreditBudget() const;
+
+    /**
+     * @brief Send a request with arbitrary query parameters.
+     * @param params Query parameters without token and format, e.g. "op=barcode-lookup&ean=...".
+     * @param result Receives the raw JSON response.
+     * @return true on success, false on error.
+     */
+    bool Query(const string & params, string & result);
+
+    /**
+     * @brief Send a request with arbitrary query parameters, e.g. to forward it.
+     * @param params Query parameters without token and format, e.g. "op=barcode-lookup&ean=...".
+     * @param result Receives the raw response, also the error body of a failed request.
+     * @param status Receives the HTTP status of the last response, 0 if there was none.
+     * @return true on success, false on error.
+     */
+    bool Query(const string & params, string & result, int & status);
+
+    /**
+     * @brief Send several requests, pipelined as far as SetPipelineDepth() allows.
+     * @param params Query parameters of each request, see Query().
+     * @param results Receives the raw JSON response of each request, empty on error.
+     * @return Number of successful requests.
+     *
+     * The requests go out on one HTTP/1.1 connection from the pool at a
+     * time, also with SetHttp2(). If the server closes the connection, the
+     * requests without a response are sent again on a new one.
+     */
+    int QueryBatch(const vector<string> & params, vector<string> & results);
+
+    /**
+     * @brief Let QueryBatch() write requests before the responses to earlier ones have arrived.
+     * @param depth Requests in flight per connection, 1 (default) to wait for each response.
+     *
+     * HTTP/1.1 pipelining saves a round trip per request without opening
+     * more connections, but some proxies mishandle it, so it is off by default.
+     */
+    void SetPipelineDepth(int depth);
+
 private:
-    bool APICall(const string & params, string & result, int tries = 1);
-    static string urlencode(const string & str);
-    static ProductList * ParseProductList(const string & str);
+    /// sends requests and parses their responses on separate threads
+    friend class AsyncEANSearch;
+
+    bool APICall(const string & params, string & result, int tries = 1,
+                 chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max(),
+                 int * http_status = nullptr);
+    bool CachedAPICall(const string & params, string & result);
+    /// QueryBatch() for the requests without a cached response, caching the new ones
+    int CachedQueryBatch(const vector<string> & params, vector<string> & results);
+    int Pipeline(const vector<string> & params, const vector<size_t> & todo, int tries,
+                 chrono::steady_clock::time_point deadline, vector<string> & results, vector<size_t> & throttled);
 
     /// API token provided at construction time
     string token;
-	int remaining;
+    /// "&token=...&format=json", appended to every request
+    string suffix;
+    string host;
+    string port;
+	atomic<int> remaining;
+    /// Shared rate and concurrency limits of all outgoing requests
+    RequestScheduler * scheduler;
+    /// Request metrics
+    ClientMetrics metrics;
+    /// Optional response cache
+    ResultCache * cache;
+    /// Optional local product snapshot
+    const SnapshotIndex * snapshot;
+    int snapshot_page_size;
+    /// Optional local search index
+    const ProductIndex * index;
+    int index_page_size;
+    /// Optional local similarity index
+    const SimilarityIndex * similarity;
+    int similarity_page_size;
+    /// Kept-alive connections to host:port
+    ConnectionPool * pool;
+    /// Optional HTTP/2 connections, used instead of the pool
+    Http2Client * http2;
+    /// Optional hedging of BarcodeLookup()
+    Hedger * hedger;
+    /// Optional circuit breaker of the endpoint
+    CircuitBreaker * breaker;
+    /// Caps of concurrent calls per operation
+    Bulkhead * bulkhead;
+    /// Optional throttling by the credits left this month
+    CreditBudget * budget;
+    /// Requests in flight per connection in QueryBatch()
+    int pipeline_depth;
+    Timeouts timeouts;
 };
 
 #endif // EANSEARCH_HPP
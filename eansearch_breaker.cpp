@@ -0,0 +1,141 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_breaker.hpp"
+
+using namespace std;
+
+CircuitBreaker::CircuitBreaker(const BreakerPolicy & policy) {
+    this->policy = policy;
+    Reset();
+}
+
+bool CircuitBreaker::Allow()
+{
+    lock_guard<mutex> guard(lock);
+    if (state == Closed) {
+        return true;
+    }
+    if (state == Open) {
+        if (chrono::steady_clock::now() - opened < policy.open_for) {
+            return false;
+        }
+        state = HalfOpen;
+        probes_sent = 0;
+        probes_passed = 0;
+    }
+    if (probes_sent < policy.probes) {
+        probes_sent++;
+        return true;
+    }
+    return false;
+}
+
+void CircuitBreaker::Record(bool failed, chrono::steady_clock::duration latency)
+{
+    bool slow = policy.slow_rate > 0 && latency >= policy.slow;
+    failed = failed && policy.error_rate > 0;
+    auto now = chrono::steady_clock::now();
+    lock_guard<mutex> guard(lock);
+    if (state == Open) {
+        return; // a request sent before the circuit opened
+    }
+    if (state == HalfOpen) {
+        if (failed || slow) {
+            Trip(now);
+        } else if (++probes_passed >= policy.probes) {
+            state = Closed;
+            for (auto & b : buckets) {
+                b = Bucket { -1, 0, 0, 0 };
+            }
+        }
+        return;
+    }
+    int64_t index = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()).count() / BREAKER_BUCKET_MS;
+    Bucket & current = buckets[index % BREAKER_BUCKETS];
+    if (current.index != index) {
+        current = Bucket { index, 0, 0, 0 };
+    }
+    current.requests++;
+    current.failures += failed;
+    current.slow += slow;
+    uint32_t requests = 0, failures = 0, slows = 0;
+    for (auto & b : buckets) {
+        if (b.index > index - BREAKER_BUCKETS) {
+            requests += b.requests;
+            failures += b.failures;
+            slows += b.slow;
+        }
+    }
+    if ((int)requests < policy.min_requests) {
+        return;
+    }
+    if ((policy.error_rate > 0 && failures >= policy.error_rate * requests)
+        || (policy.slow_rate > 0 && slows >= policy.slow_rate * requests)) {
+        Trip(now);
+    }
+}
+
+void CircuitBreaker::Abandon()
+{
+    lock_guard<mutex> guard(lock);
+    if (state == HalfOpen && probes_sent > 0) {
+        probes_sent--;
+    }
+}
+
+void CircuitBreaker::Reset()
+{
+    lock_guard<mutex> guard(lock);
+    state = Closed;
+    for (auto & b : buckets) {
+        b = Bucket { -1, 0, 0, 0 };
+    }
+    probes_sent = 0;
+    probes_passed = 0;
+}
+
+CircuitBreaker::State CircuitBreaker::GetState() const
+{
+    lock_guard<mutex> guard(lock);
+    return state;
+}
+
+void CircuitBreaker::Trip(chrono::steady_clock::time_point now)
+{
+    state = Open;
+    opened = now;
+}
+
+Bulkhead::Bulkhead() {
+    for (int i = 0; i < METRICS_OP_COUNT; i++) {
+        limits[i] = 0;
+        in_flight[i] = 0;
+    }
+}
+
+void Bulkhead::SetLimit(string_view op, int limit)
+{
+    limits[ClientMetrics::OpIndex(op)] = limit;
+}
+
+bool Bulkhead::Enter(int op)
+{
+    int limit = limits[op].load(memory_order_relaxed);
+    if (in_flight[op].fetch_add(1) >= limit && limit > 0) {
+        in_flight[op]--;
+        return false;
+    }
+    return true;
+}
+
+void Bulkhead::Leave(int op)
+{
+    in_flight[op]--;
+}
@@ -0,0 +1,137 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_BREAKER_HPP
+#define EANSEARCH_BREAKER_HPP
+
+#include <string_view>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "eansearch_metrics.hpp"
+using namespace std;
+
+
+/// The error and slow rates are judged over this many buckets
+const int BREAKER_BUCKETS = 10;
+/// Length of a bucket
+const int BREAKER_BUCKET_MS = 1000;
+
+/**
+ * @brief When a circuit breaker opens and closes again.
+ */
+struct BreakerPolicy {
+    /// Share of failed requests (network errors, timeouts, 5xx) that opens the circuit, 0 to ignore failures
+    double error_rate { 0.5 };
+    /// Requests slower than this count as slow
+    chrono::milliseconds slow { 5000 };
+    /// Share of slow requests that opens the circuit, 0 to ignore latency
+    double slow_rate { 0.5 };
+    /// Requests within the window before the rates are judged
+    int min_requests { 20 };
+    /// Time the circuit stays open before trial requests go out
+    chrono::milliseconds open_for { 5000 };
+    /// Trial requests while half-open; all must succeed to close the circuit
+    int probes { 3 };
+};
+
+/**
+ * @brief Fails requests fast while the server they go to is failing.
+ *
+ * Closed, it counts the requests, failures and slow requests of the last
+ * BREAKER_BUCKETS * BREAKER_BUCKET_MS milliseconds, and opens when one of
+ * the rates is reached. Open, it refuses all requests for a while, then
+ * half-opens and lets a few trial requests through: it closes when they
+ * all succeed and opens again on the first one that fails.
+ */
+class CircuitBreaker
+{
+public:
+    enum State { Closed, Open, HalfOpen };
+
+    CircuitBreaker(const BreakerPolicy & policy);
+
+    /**
+     * @brief Whether a request may go out now; each allowed request must be recorded.
+     */
+    bool Allow();
+
+    /**
+     * @brief Record the outcome of an allowed request.
+     * @param failed The request failed without a usable response.
+     * @param latency Time until the response or the failure.
+     */
+    void Record(bool failed, chrono::steady_clock::duration latency);
+
+    /**
+     * @brief Give back an allowed request that was not sent after all.
+     */
+    void Abandon();
+
+    /**
+     * @brief Close the circuit and forget all requests, e.g. for a new endpoint.
+     */
+    void Reset();
+
+    State GetState() const;
+
+private:
+    struct Bucket {
+        int64_t index;
+        uint32_t requests;
+        uint32_t failures;
+        uint32_t slow;
+    };
+
+    void Trip(chrono::steady_clock::time_point now);
+
+    BreakerPolicy policy;
+    mutable mutex lock;
+    State state;
+    Bucket buckets[BREAKER_BUCKETS];
+    chrono::steady_clock::time_point opened;
+    int probes_sent;
+    int probes_passed;
+};
+
+/**
+ * @brief Caps the concurrent calls of each API operation.
+ *
+ * Calls beyond the cap of their operation fail right away instead of
+ * waiting for a connection or the rate limiter, so a slow operation
+ * can't take all threads and connections from the others.
+ */
+class Bulkhead
+{
+public:
+    Bulkhead();
+
+    /**
+     * @brief Set the cap of an operation.
+     * @param op Operation name from METRICS_OPS, e.g. "similar-product-search".
+     * @param limit Concurrent calls, 0 for no cap (default).
+     */
+    void SetLimit(string_view op, int limit);
+
+    /**
+     * @brief Start a call of an operation.
+     * @param op Index of the operation in METRICS_OPS.
+     * @return false if the operation is at its cap; Leave() must follow otherwise.
+     */
+    bool Enter(int op);
+
+    void Leave(int op);
+
+private:
+    atomic<int> limits[METRICS_OP_COUNT];
+    atomic<int> in_flight[METRICS_OP_COUNT];
+};
+
+#endif // EANSEARCH_BREAKER_HPP
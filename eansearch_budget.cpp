@@ -0,0 +1,179 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_budget.hpp"
+#include <algorithm>
+#include <thread>
+#include <ctime>
+
+using namespace std;
+
+/// Caller tag of the calls of this thread, see ScopedCallerTag
+static thread_local string thread_tag;
+
+ScopedCallerTag::ScopedCallerTag(const string & tag) {
+    this->previous = thread_tag;
+    thread_tag = tag;
+}
+
+ScopedCallerTag::~ScopedCallerTag() {
+    thread_tag = previous;
+}
+
+const string & ScopedCallerTag::Current() {
+    return thread_tag;
+}
+
+/**
+ * @brief Time until the start of the next month (UTC), when the credits are renewed.
+ */
+static chrono::seconds MonthLeft() {
+    time_t now = chrono::system_clock::to_time_t(chrono::system_clock::now());
+    tm utc;
+    gmtime_r(&now, &utc);
+    utc.tm_mday = 1;
+    utc.tm_hour = 0;
+    utc.tm_min = 0;
+    utc.tm_sec = 0;
+    utc.tm_mon++; // timegm() carries December over into the next year
+    time_t end = timegm(&utc);
+    return chrono::seconds(max<time_t>(end - now, 1));
+}
+
+CreditBudget::CreditBudget(const BudgetPolicy & policy) {
+    this->policy = policy;
+    for (auto & n : by_op) {
+        n = 0;
+    }
+    Reset();
+}
+
+bool CreditBudget::Admit(Priority priority, chrono::steady_clock::time_point deadline)
+{
+    if (priority == PriorityInteractive) {
+        return true;
+    }
+    auto month_left = MonthLeft();
+    auto now = chrono::steady_clock::now();
+    unique_lock<mutex> guard(lock);
+    if (remaining < 0) {
+        return true; // nothing known yet
+    }
+    if (remaining <= policy.reserve) {
+        return false;
+    }
+    if (!Throttling(now, month_left)) {
+        return true;
+    }
+    if (priority == PriorityBatch) {
+        return false;
+    }
+    // space normal calls out to the rate the credits left allow
+    auto start = max(now, next_normal);
+    if (start - now > policy.max_delay || start > deadline) {
+        return false;
+    }
+    next_normal = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1 / Affordable(month_left)));
+    guard.unlock();
+    this_thread::sleep_until(start);
+    return true;
+}
+
+void CreditBudget::Record(int op, int remaining)
+{
+    by_op[op]++;
+    auto now = chrono::steady_clock::now();
+    int64_t index = chrono::duration_cast<chrono::seconds>(now.time_since_epoch()).count() / BUDGET_BUCKET_S;
+    lock_guard<mutex> guard(lock);
+    by_tag[ScopedCallerTag::Current()]++;
+    if (this->remaining >= 0 && remaining > this->remaining) {
+        // more credits than before: renewed, topped up or an overtaken response
+        int highest = -1;
+        for (auto & b : buckets) {
+            if (b.index > index - BUDGET_BUCKETS) {
+                highest = max(highest, b.remaining);
+            }
+        }
+        if (remaining <= highest) {
+            return; // a response that was overtaken by a later one
+        }
+        for (auto & b : buckets) {
+            b.index = -1;
+        }
+    }
+    this->remaining = remaining;
+    Bucket & current = buckets[index % BUDGET_BUCKETS];
+    if (current.index != index) {
+        current = Bucket { index, now, remaining };
+    }
+}
+
+void CreditBudget::Reset()
+{
+    lock_guard<mutex> guard(lock);
+    remaining = -1;
+    for (auto & b : buckets) {
+        b = Bucket { -1, chrono::steady_clock::time_point(), -1 };
+    }
+    next_normal = chrono::steady_clock::time_point();
+}
+
+BudgetStatus CreditBudget::Status() const
+{
+    BudgetStatus status;
+    status.month_left = MonthLeft();
+    for (auto & n : by_op) {
+        status.by_op.push_back(n.load(memory_order_relaxed));
+    }
+    auto now = chrono::steady_clock::now();
+    lock_guard<mutex> guard(lock);
+    status.remaining = remaining;
+    double rate = BurnRate(now);
+    if (rate >= 0) {
+        status.burn_rate = rate * 3600;
+        status.projected = rate * status.month_left.count();
+    }
+    status.throttling = Throttling(now, status.month_left);
+    status.by_tag = by_tag;
+    return status;
+}
+
+double CreditBudget::BurnRate(chrono::steady_clock::time_point now) const
+{
+    int64_t index = chrono::duration_cast<chrono::seconds>(now.time_since_epoch()).count() / BUDGET_BUCKET_S;
+    const Bucket * oldest = nullptr;
+    for (auto & b : buckets) {
+        if (b.index > index - BUDGET_BUCKETS && (!oldest || b.index < oldest->index)) {
+            oldest = &b;
+        }
+    }
+    if (!oldest || remaining < 0) {
+        return -1;
+    }
+    // at least a bucket long, so a burst right after the start doesn't look like the rate of the month
+    double seconds = max(chrono::duration<double>(now - oldest->time).count(), (double)BUDGET_BUCKET_S);
+    return max(oldest->remaining - remaining, 0) / seconds;
+}
+
+double CreditBudget::Affordable(chrono::seconds month_left) const
+{
+    return max(remaining - policy.reserve, 0) / (double)month_left.count();
+}
+
+bool CreditBudget::Throttling(chrono::steady_clock::time_point now, chrono::seconds month_left) const
+{
+    if (remaining < 0) {
+        return false;
+    }
+    if (remaining <= policy.reserve) {
+        return true;
+    }
+    double rate = BurnRate(now);
+    return rate > 0 && rate * month_left.count() > policy.throttle_at * (remaining - policy.reserve);
+}
@@ -0,0 +1,150 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_BUDGET_HPP
+#define EANSEARCH_BUDGET_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "eansearch.hpp"
+#include "eansearch_metrics.hpp"
+using namespace std;
+
+
+/// The burn rate is measured over this many buckets
+const int BUDGET_BUCKETS = 60;
+/// Length of a bucket
+const int BUDGET_BUCKET_S = 60;
+
+/**
+ * @brief When a credit budget throttles and refuses calls.
+ */
+struct BudgetPolicy {
+    /// Throttle when the projected use until the end of the month exceeds this share of the credits left, 0 to turn the budget off
+    double throttle_at { 1.0 };
+    /// Credits kept for interactive calls: below it, normal and batch calls are refused
+    int reserve { 0 };
+    /// Longest delay of a throttled normal call; calls that would wait longer are refused
+    chrono::milliseconds max_delay { 1000 };
+};
+
+/**
+ * @brief Tags the API calls this thread makes while it is in scope, for CreditBudget::Status().
+ *
+ * Calls are untagged ("") unless set.
+ */
+class ScopedCallerTag {
+public:
+    ScopedCallerTag(const string & tag);
+    ~ScopedCallerTag();
+
+    /**
+     * @brief Tag of the calls of this thread.
+     */
+    static const string & Current();
+
+private:
+    ScopedCallerTag(const ScopedCallerTag &) = delete;
+    ScopedCallerTag & operator=(const ScopedCallerTag &) = delete;
+
+    string previous;
+};
+
+/**
+ * @brief Credit consumption and its projection to the end of the month.
+ */
+struct BudgetStatus {
+    /// Last X-Credits-Remaining value, -1 if unknown
+    int remaining { -1 };
+    /// Credits used per hour by everybody sharing the account, -1 if unknown
+    double burn_rate { -1 };
+    /// Credits that will be used until the end of the month at the burn rate, -1 if unknown
+    double projected { -1 };
+    /// Time until the credits are renewed
+    chrono::seconds month_left { 0 };
+    /// Normal calls are slowed down and batch calls refused
+    bool throttling { false };
+    /// Credits used by this client, one entry per operation in METRICS_OPS
+    vector<int64_t> by_op;
+    /// Credits used by this client per caller tag, see ScopedCallerTag
+    map<string, int64_t> by_tag;
+};
+
+/**
+ * @brief Spreads the credits left over the rest of the month.
+ *
+ * The burn rate is taken from the X-Credits-Remaining values of the
+ * responses of the last BUDGET_BUCKETS * BUDGET_BUCKET_S seconds, so it
+ * includes the calls of all processes sharing the API token without any
+ * coordination between them. When the rate, kept up until the credits
+ * are renewed at the start of the next month (UTC), would use more than
+ * the credits left, low-priority calls give way: batch calls are refused
+ * and normal calls are spaced out to the rate the credits allow.
+ * Interactive calls are never held back.
+ */
+class CreditBudget
+{
+public:
+    CreditBudget(const BudgetPolicy & policy);
+
+    /**
+     * @brief Whether a call may go out; throttled normal calls are delayed here.
+     * @param priority Class of the call, see ScopedPriority.
+     * @param deadline Don't delay the call past this point in time.
+     * @return false if the call should be refused.
+     */
+    bool Admit(Priority priority, chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Record an answered request, which used a credit.
+     * @param op Index of the operation in METRICS_OPS.
+     * @param remaining X-Credits-Remaining value of the response.
+     */
+    void Record(int op, int remaining);
+
+    /**
+     * @brief Forget the X-Credits-Remaining values seen so far, e.g. for a new endpoint.
+     */
+    void Reset();
+
+    BudgetStatus Status() const;
+
+private:
+    CreditBudget(const CreditBudget &) = delete;
+    CreditBudget & operator=(const CreditBudget &) = delete;
+
+    struct Bucket {
+        int64_t index;
+        /// First sample of the bucket
+        chrono::steady_clock::time_point time;
+        int remaining;
+    };
+
+    /// Credits per second used by everybody, -1 if unknown
+    double BurnRate(chrono::steady_clock::time_point now) const;
+    /// Credits per second the rest of the month can afford
+    double Affordable(chrono::seconds month_left) const;
+    bool Throttling(chrono::steady_clock::time_point now, chrono::seconds month_left) const;
+
+    BudgetPolicy policy;
+    mutable mutex lock;
+    int remaining;
+    Bucket buckets[BUDGET_BUCKETS];
+    /// Earliest start of the next throttled normal call
+    chrono::steady_clock::time_point next_normal;
+    atomic<int64_t> by_op[METRICS_OP_COUNT];
+    map<string, int64_t> by_tag;
+};
+
+#endif // EANSEARCH_BUDGET_HPP
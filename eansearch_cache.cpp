@@ -0,0 +1,373 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_cache.hpp"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/**
+ * @brief Layout of a table slot; key and response bytes follow.
+ *
+ * seq is 0 for a slot that was never used and odd while it is written.
+ */
+struct CacheSlot {
+    atomic<uint32_t> seq;
+    uint32_t key_len;
+    uint32_t value_len;
+    uint32_t reserved;
+    uint64_t hash;
+    int64_t timestamp;
+};
+
+/**
+ * @brief Header at the start of a cache file.
+ */
+struct CacheFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t slots;
+};
+
+/**
+ * @brief Header at the start of a shared memory cache.
+ *
+ * ready is set by the creating process once the header is complete.
+ */
+struct SharedCacheHeader {
+    CacheFileHeader geometry;
+    atomic<uint32_t> ready;
+};
+
+static const char CACHE_MAGIC[8] = { 'E', 'A', 'N', 'C', 'A', 'C', 'H', 'E' };
+static const uint32_t CACHE_VERSION = 1;
+/// The slot array starts at this offset in a cache file
+static const size_t CACHE_HEADER_SIZE = 64;
+/// Time to wait for another process to create a shared memory cache
+static const int CACHE_CREATE_WAIT_MS = 1000;
+/// Attempts to read a slot that changes while it is copied
+static const int CACHE_READ_RETRIES = 4;
+
+/**
+ * @brief FNV-1a hash of a cache key.
+ */
+static uint64_t HashKey(const string & key) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+MappedCache::MappedCache() {
+    this->base = nullptr;
+    this->slots = 0;
+    this->slot_size = 0;
+    this->writable = false;
+    this->max_age = 0;
+}
+
+void MappedCache::Attach(char * base, uint64_t slots, uint32_t slot_size, bool writable)
+{
+    this->base = base;
+    this->slots = slots;
+    this->slot_size = slot_size;
+    this->writable = writable;
+}
+
+void MappedCache::SetMaxAge(int seconds)
+{
+    max_age = seconds;
+}
+
+bool MappedCache::IsOpen() const
+{
+    return base != nullptr;
+}
+
+bool MappedCache::IsWriter() const
+{
+    return base != nullptr && writable;
+}
+
+CacheSlot * MappedCache::SlotAt(uint64_t i)
+{
+    return reinterpret_cast<CacheSlot *>(base + i * slot_size);
+}
+
+bool MappedCache::Get(const string & key, string & value)
+{
+    if (!base) {
+        return false;
+    }
+    uint64_t h = HashKey(key);
+    size_t capacity = slot_size - sizeof(CacheSlot);
+    for (int probe = 0; probe < CACHE_MAX_PROBE; probe++) {
+        CacheSlot * s = SlotAt((h + probe) % slots);
+        const char * data = reinterpret_cast<const char *>(s + 1);
+        for (int attempt = 0; attempt < CACHE_READ_RETRIES; attempt++) {
+            uint32_t seq = s->seq.load(memory_order_acquire);
+            if (seq == 0) {
+                return false; // slots are never emptied, so the key isn't further on
+            }
+            if (seq & 1) {
+                continue; // being written
+            }
+            size_t key_len = s->key_len;
+            size_t value_len = s->value_len;
+            int64_t timestamp = s->timestamp;
+            bool match = s->hash == h && key_len == key.size() && key_len + value_len <= capacity
+                && memcmp(data, key.data(), key_len) == 0;
+            if (match) {
+                value.assign(data + key_len, value_len);
+            }
+            atomic_thread_fence(memory_order_acquire);
+            if (s->seq.load(memory_order_relaxed) != seq) {
+                continue; // changed while copying
+            }
+            if (!match) {
+                break;
+            }
+            return max_age <= 0 || time(nullptr) - timestamp <= max_age;
+        }
+    }
+    return false;
+}
+
+void MappedCache::Put(const string & key, const string & value)
+{
+    size_t capacity = slot_size - sizeof(CacheSlot);
+    if (!base || !writable || key.size() + value.size() > capacity) {
+        return;
+    }
+    uint64_t h = HashKey(key);
+    int64_t now = time(nullptr);
+
+    // use an empty slot or the one holding the key, else evict the oldest
+    CacheSlot * victim = nullptr;
+    int64_t oldest = 0;
+    for (int probe = 0; probe < CACHE_MAX_PROBE; probe++) {
+        CacheSlot * s = SlotAt((h + probe) % slots);
+        uint32_t seq = s->seq.load(memory_order_acquire);
+        if (seq == 0) {
+            victim = s;
+            break;
+        }
+        if (seq & 1) {
+            continue;
+        }
+        if (s->hash == h && s->key_len == key.size()
+            && memcmp(reinterpret_cast<const char *>(s + 1), key.data(), key.size()) == 0) {
+            victim = s;
+            break;
+        }
+        if (!victim || s->timestamp < oldest) {
+            victim = s;
+            oldest = s->timestamp;
+        }
+    }
+    if (!victim) {
+        return;
+    }
+    uint32_t seq = victim->seq.load(memory_order_relaxed);
+    if ((seq & 1) || !victim->seq.compare_exchange_strong(seq, seq + 1, memory_order_acq_rel)) {
+        return; // another thread is writing this slot
+    }
+    atomic_thread_fence(memory_order_release);
+    victim->hash = h;
+    victim->key_len = key.size();
+    victim->value_len = value.size();
+    victim->timestamp = now;
+    char * data = reinterpret_cast<char *>(victim + 1);
+    memcpy(data, key.data(), key.size());
+    memcpy(data + key.size(), value.data(), value.size());
+    victim->seq.store(seq + 2, memory_order_release);
+}
+
+void MappedCache::Recover()
+{
+    for (uint64_t i = 0; i < slots; i++) {
+        CacheSlot * s = SlotAt(i);
+        uint32_t seq = s->seq.load(memory_order_relaxed);
+        if (seq & 1) {
+            s->key_len = 0; // matches no key
+            s->value_len = 0;
+            s->seq.store(seq + 1, memory_order_release);
+        }
+    }
+}
+
+DiskCache::DiskCache(const string & filename, uint64_t slots, uint32_t slot_size) {
+    this->map = nullptr;
+    this->map_size = 0;
+
+    bool writer = false;
+    fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd >= 0) {
+        writer = flock(fd, LOCK_EX | LOCK_NB) == 0;
+    } else {
+        fd = open(filename.c_str(), O_RDONLY);
+    }
+    if (fd < 0) {
+        cerr << "Error: can't open cache file " << filename << ": " << strerror(errno) << endl;
+        return;
+    }
+
+    CacheFileHeader header;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        cerr << "Error: can't open cache file " << filename << ": " << strerror(errno) << endl;
+        return;
+    }
+    if ((size_t)st.st_size < CACHE_HEADER_SIZE && writer) {
+        // new file
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+        header.version = CACHE_VERSION;
+        header.slot_size = max<uint32_t>(sizeof(CacheSlot) + 32, (slot_size + 7) & ~7u);
+        header.slots = slots > 0 ? slots : 1;
+        if (ftruncate(fd, CACHE_HEADER_SIZE + header.slots * header.slot_size) != 0
+            || pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+            cerr << "Error: can't create cache file " << filename << ": " << strerror(errno) << endl;
+            return;
+        }
+        st.st_size = CACHE_HEADER_SIZE + header.slots * header.slot_size;
+    } else if (pread(fd, &header, sizeof(header), 0) != sizeof(header)
+        || memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != CACHE_VERSION) {
+        cerr << "Error: " << filename << " is not a cache file" << endl;
+        return;
+    }
+
+    size_t size = CACHE_HEADER_SIZE + header.slots * header.slot_size;
+    if ((size_t)st.st_size < size) {
+        cerr << "Error: cache file " << filename << " is truncated" << endl;
+        return;
+    }
+    void * m = mmap(nullptr, size, writer ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        cerr << "Error: can't map cache file " << filename << ": " << strerror(errno) << endl;
+        return;
+    }
+    map = static_cast<char *>(m);
+    map_size = size;
+    Attach(map + CACHE_HEADER_SIZE, header.slots, header.slot_size, writer);
+    if (writer) {
+        Recover();
+    }
+}
+
+DiskCache::~DiskCache() {
+    if (map) {
+        munmap(map, map_size);
+    }
+    if (fd >= 0) {
+        close(fd); // releases the writer lock
+    }
+}
+
+SharedMemoryCache::SharedMemoryCache(const string & name, uint64_t slots, uint32_t slot_size) {
+    this->map = nullptr;
+    this->map_size = 0;
+
+    bool creator = true;
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        creator = false;
+        fd = shm_open(name.c_str(), O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        cerr << "Error: can't open shared memory cache " << name << ": " << strerror(errno) << endl;
+        return;
+    }
+
+    size_t size = 0;
+    SharedCacheHeader * header = nullptr;
+    if (creator) {
+        slot_size = max<uint32_t>(sizeof(CacheSlot) + 32, (slot_size + 7) & ~7u);
+        slots = slots > 0 ? slots : 1;
+        size = CACHE_HEADER_SIZE + slots * slot_size;
+        void * m = MAP_FAILED;
+        if (ftruncate(fd, size) == 0) {
+            m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (m == MAP_FAILED) {
+            cerr << "Error: can't create shared memory cache " << name << ": " << strerror(errno) << endl;
+            close(fd);
+            shm_unlink(name.c_str());
+            return;
+        }
+        header = static_cast<SharedCacheHeader *>(m);
+        memcpy(header->geometry.magic, CACHE_MAGIC, sizeof(header->geometry.magic));
+        header->geometry.version = CACHE_VERSION;
+        header->geometry.slot_size = slot_size;
+        header->geometry.slots = slots;
+        header->ready.store(1, memory_order_release);
+    } else {
+        // wait until the creating process has sized and initialized the table
+        bool ready = false;
+        for (int waited = 0; !ready && waited < CACHE_CREATE_WAIT_MS; waited++) {
+            struct stat st;
+            void * m = MAP_FAILED;
+            if (fstat(fd, &st) == 0 && (size_t)st.st_size >= CACHE_HEADER_SIZE) {
+                m = mmap(nullptr, CACHE_HEADER_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+            }
+            if (m != MAP_FAILED) {
+                auto * h = static_cast<SharedCacheHeader *>(m);
+                ready = h->ready.load(memory_order_acquire) != 0;
+                if (ready && memcmp(h->geometry.magic, CACHE_MAGIC, sizeof(h->geometry.magic)) == 0
+                    && h->geometry.version == CACHE_VERSION) {
+                    size = CACHE_HEADER_SIZE + h->geometry.slots * h->geometry.slot_size;
+                }
+                munmap(m, CACHE_HEADER_SIZE);
+            }
+            if (!ready) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        }
+        if (size > 0) {
+            void * m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (m != MAP_FAILED) {
+                header = static_cast<SharedCacheHeader *>(m);
+            }
+        }
+        if (!header) {
+            cerr << "Error: " << name << " is not a usable shared memory cache" << endl;
+            close(fd);
+            return;
+        }
+    }
+    close(fd); // the mapping stays valid
+
+    map = reinterpret_cast<char *>(header);
+    map_size = size;
+    Attach(map + CACHE_HEADER_SIZE, header->geometry.slots, header->geometry.slot_size, true);
+}
+
+SharedMemoryCache::~SharedMemoryCache() {
+    if (map) {
+        munmap(map, map_size);
+    }
+}
+
+bool SharedMemoryCache::Remove(const string & name)
+{
+    return shm_unlink(name.c_str()) == 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_CACHE_HPP
+#define EANSEARCH_CACHE_HPP
+
+#include "eansearch.hpp"
+#include <cstdint>
+using namespace std;
+
+
+/// Number of consecutive slots searched for a key
+const int CACHE_MAX_PROBE = 8;
+
+struct CacheSlot;
+
+/**
+ * @brief Response cache stored in a shared memory mapping (POSIX only).
+ *
+ * An open-addressing hash table with fixed-size slots. Each slot is
+ * guarded by a sequence counter that is odd while the slot is written,
+ * so readers copy an entry without taking locks or making system calls
+ * and retry if it changed underneath them. When all slots a key may use
+ * are taken, the oldest entry among them is overwritten.
+ *
+ * Subclasses create the mapping and call Attach().
+ */
+class MappedCache : public ResultCache
+{
+public:
+    virtual ~MappedCache() { };
+
+    bool Get(const string & key, string & value) override;
+    void Put(const string & key, const string & value) override;
+
+    /**
+     * @brief Ignore entries older than this.
+     * @param seconds Maximum age in seconds (0 = entries never expire).
+     */
+    void SetMaxAge(int seconds);
+
+    /**
+     * @brief Check if the cache could be mapped.
+     */
+    bool IsOpen() const;
+
+    /**
+     * @brief Check if this process may store entries.
+     */
+    bool IsWriter() const;
+
+protected:
+    MappedCache();
+
+    /**
+     * @brief Use a mapped table; a zero-filled table is a valid empty one.
+     * @param base Start of the slot array.
+     * @param slots Number of slots.
+     * @param slot_size Size of one slot in bytes.
+     * @param writable true if Put() may write to the table.
+     */
+    void Attach(char * base, uint64_t slots, uint32_t slot_size, bool writable);
+
+    /**
+     * @brief Repair slots left half-written by a crashed writer.
+     */
+    void Recover();
+
+private:
+    CacheSlot * SlotAt(uint64_t i);
+
+    char * base;
+    uint64_t slots;
+    uint32_t slot_size;
+    bool writable;
+    int max_age;
+};
+
+/**
+ * @brief Persistent response cache in a memory-mapped file.
+ *
+ * Survives restarts, so repeated lookups after a restart cost no credits.
+ * Any number of processes may read the file; the first process to open
+ * it for writing holds an exclusive lock on it, later ones open it read-only.
+ */
+class DiskCache : public MappedCache
+{
+public:
+    /**
+     * @brief Open or create a cache file.
+     * @param filename Cache file.
+     * @param slots Number of entries of a new file.
+     * @param slot_size Size of an entry (key and response) of a new file.
+     *
+     * The size of an existing file is kept. Check IsOpen() for errors.
+     */
+    DiskCache(const string & filename, uint64_t slots = 65536, uint32_t slot_size = 1024);
+    ~DiskCache();
+
+private:
+    int fd;
+    char * map;
+    size_t map_size;
+};
+
+/**
+ * @brief Response cache in POSIX shared memory, shared by all processes on a host.
+ *
+ * Every process that opens the same name uses the same table and may store
+ * entries, e.g. the workers of a pre-forked server. Memory use is fixed
+ * when the first process creates the table; the table lives until
+ * Remove() is called or the host reboots.
+ */
+class SharedMemoryCache : public MappedCache
+{
+public:
+    /**
+     * @brief Open or create a shared memory cache.
+     * @param name Shared memory object name, e.g. "/eansearch".
+     * @param slots Number of entries if the table is created.
+     * @param slot_size Size of an entry (key and response) if the table is created.
+     *
+     * Check IsOpen() for errors.
+     */
+    SharedMemoryCache(const string & name, uint64_t slots = 65536, uint32_t slot_size = 1024);
+    ~SharedMemoryCache();
+
+    /**
+     * @brief Delete a shared memory cache; processes using it keep their mapping.
+     * @param name Shared memory object name.
+     * @return true on success.
+     */
+    static bool Remove(const string & name);
+
+private:
+    char * map;
+    size_t map_size;
+};
+
+#endif // EANSEARCH_CACHE_HPP
@@ -0,0 +1,78 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_CODEC_HPP
+#define EANSEARCH_CODEC_HPP
+
+#include <string>
+#include <string_view>
+#include <boost/json.hpp>
+#include "eansearch.hpp"
+using namespace std;
+
+
+// Encoding of request parameters and parsing of API responses, shared by
+// EANSearch, AsyncEANSearch and microbench; not part of the public API.
+
+/**
+ * @brief Percent-encode a string for use in URL query components (RFC 3986).
+ * @param str Input string to encode.
+ * @return Encoded string where non-unreserved characters are percent-encoded.
+ */
+string urlencode(const string & str);
+
+/**
+ * @brief Percent-encode a string and append it to a buffer.
+ */
+void urlencode(const string & str, string & out);
+
+/*
+ * Query parameters of the API operations. They are also the keys of cached
+ * responses, so EANSearch and AsyncEANSearch must build them the same way.
+ * Each one replaces the contents of out, which keeps its capacity.
+ */
+
+void BarcodeLookupParams(string & out, const string & ean, int language);
+void IsbnLookupParams(string & out, const string & isbn);
+void VerifyChecksumParams(string & out, const string & ean);
+
+/**
+ * @brief Query parameters of a search by name.
+ * @param op "op=product-search&name=" or "op=similar-product-search&name=".
+ */
+void SearchParams(string & out, const char * op, const string & name, int language, int page);
+
+void CategorySearchParams(string & out, int category, const string & name, int language, int page);
+void PrefixSearchParams(string & out, const string & prefix, int language, int page);
+void IssuingCountryParams(string & out, const string & ean);
+void BarcodeImageParams(string & out, const string & ean, int width, int height);
+
+/**
+ * @brief Operation name of query parameters starting with "op=", see EANSearch::Query().
+ * @return Empty if the parameters don't start with "op=".
+ */
+string_view OpOf(const string & params);
+
+/**
+ * @brief Product of one JSON object of a response, a ProductFull if it has a googleCategoryId.
+ * @return nullptr if the value isn't an object; throws if a field is missing.
+ */
+Product * ProductFromJSON(const boost::json::value & api_result);
+
+/**
+ * @brief Products of a search response, nullptr if it can't be parsed.
+ */
+ProductList * ParseProductList(const string & str);
+
+/**
+ * @brief Product of a barcode lookup response, nullptr if there is none or it can't be parsed.
+ */
+ProductFull * ParseBarcode(const string & str);
+
+#endif // EANSEARCH_CODEC_HPP
@@ -0,0 +1,134 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_compress.hpp"
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+/// zlib window bits: 15 plus 32 detects a gzip or zlib header
+static const int WINDOW_AUTO = 15 + 32;
+/// zlib window bits for raw deflate data without a header
+static const int WINDOW_RAW = -15;
+
+Decompressor::Decompressor() {
+#ifndef EANSEARCH_NO_COMPRESSION
+    memset(&zs, 0, sizeof(zs));
+    this->zs_ready = inflateInit2(&zs, WINDOW_AUTO) == Z_OK;
+#endif
+#ifdef EANSEARCH_BROTLI
+    this->brotli = nullptr;
+#endif
+}
+
+Decompressor::~Decompressor() {
+#ifndef EANSEARCH_NO_COMPRESSION
+    if (zs_ready) {
+        inflateEnd(&zs);
+    }
+#endif
+#ifdef EANSEARCH_BROTLI
+    if (brotli) {
+        BrotliDecoderDestroyInstance(brotli);
+    }
+#endif
+}
+
+const char * Decompressor::AcceptEncoding()
+{
+#if defined(EANSEARCH_NO_COMPRESSION)
+    return "";
+#elif defined(EANSEARCH_BROTLI)
+    return "br, gzip, deflate";
+#else
+    return "gzip, deflate";
+#endif
+}
+
+#ifndef EANSEARCH_NO_COMPRESSION
+bool Decompressor::Inflate(const string & in, string & out, int window_bits)
+{
+    if (!zs_ready || inflateReset2(&zs, window_bits) != Z_OK) {
+        return false;
+    }
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+    zs.avail_in = in.size();
+    size_t size = 0;
+    out.resize(max<size_t>({ out.capacity(), in.size() * 4, 256 }));
+    for (;;) {
+        if (size == out.size()) {
+            out.resize(out.size() * 2);
+        }
+        zs.next_out = reinterpret_cast<Bytef *>(&out[size]);
+        zs.avail_out = out.size() - size;
+        int rc = inflate(&zs, Z_NO_FLUSH);
+        size = out.size() - zs.avail_out;
+        if (rc == Z_STREAM_END) {
+            out.resize(size);
+            return true;
+        }
+        if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            return false;
+        }
+        if (rc == Z_BUF_ERROR && zs.avail_in == 0) {
+            return false; // truncated
+        }
+    }
+}
+#endif
+
+bool Decompressor::Decompress(string_view encoding, const string & in, string & out)
+{
+    if (encoding.empty() || encoding == "identity") {
+        out = in;
+        return true;
+    }
+#ifndef EANSEARCH_NO_COMPRESSION
+    if (encoding == "gzip" || encoding == "x-gzip") {
+        return Inflate(in, out, WINDOW_AUTO);
+    }
+    if (encoding == "deflate") {
+        // RFC 9110 means zlib format, but some servers send raw deflate data
+        return Inflate(in, out, WINDOW_AUTO) || Inflate(in, out, WINDOW_RAW);
+    }
+#endif
+#ifdef EANSEARCH_BROTLI
+    if (encoding == "br") {
+        if (brotli) {
+            BrotliDecoderDestroyInstance(brotli); // brotli decoders can't be reset
+        }
+        brotli = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+        if (!brotli) {
+            return false;
+        }
+        const uint8_t * next_in = reinterpret_cast<const uint8_t *>(in.data());
+        size_t avail_in = in.size();
+        size_t size = 0;
+        out.resize(max<size_t>({ out.capacity(), in.size() * 4, 256 }));
+        for (;;) {
+            if (size == out.size()) {
+                out.resize(out.size() * 2);
+            }
+            uint8_t * next_out = reinterpret_cast<uint8_t *>(&out[size]);
+            size_t avail_out = out.size() - size;
+            BrotliDecoderResult rc = BrotliDecoderDecompressStream(brotli, &avail_in, &next_in, &avail_out, &next_out, nullptr);
+            size = out.size() - avail_out;
+            if (rc == BROTLI_DECODER_RESULT_SUCCESS) {
+                out.resize(size);
+                return true;
+            }
+            if (rc != BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) {
+                return false;
+            }
+        }
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,69 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_COMPRESS_HPP
+#define EANSEARCH_COMPRESS_HPP
+
+#include <string>
+#include <string_view>
+#ifndef EANSEARCH_NO_COMPRESSION
+#include <zlib.h>
+#endif
+#ifdef EANSEARCH_BROTLI
+#include <brotli/decode.h>
+#endif
+using namespace std;
+
+
+/**
+ * @brief Decoder for compressed HTTP response bodies.
+ *
+ * Supports gzip and deflate through zlib, and br if built with
+ * EANSEARCH_BROTLI (link with -lbrotlidec). Build with
+ * EANSEARCH_NO_COMPRESSION to request uncompressed responses only.
+ *
+ * The decoder state is allocated once and reset for each body, so one
+ * Decompressor per connection serves all its responses.
+ */
+class Decompressor
+{
+public:
+    Decompressor();
+    ~Decompressor();
+
+    /**
+     * @brief Value of the Accept-Encoding request header, empty if nothing is supported.
+     */
+    static const char * AcceptEncoding();
+
+    /**
+     * @brief Decode a response body.
+     * @param encoding Value of the Content-Encoding header.
+     * @param in Encoded body.
+     * @param out Receives the decoded body; its capacity is reused.
+     * @return false if the encoding is unsupported or the body is corrupt.
+     */
+    bool Decompress(string_view encoding, const string & in, string & out);
+
+private:
+    Decompressor(const Decompressor &) = delete;
+    Decompressor & operator=(const Decompressor &) = delete;
+
+#ifndef EANSEARCH_NO_COMPRESSION
+    bool Inflate(const string & in, string & out, int window_bits);
+
+    z_stream zs;
+    bool zs_ready;
+#endif
+#ifdef EANSEARCH_BROTLI
+    BrotliDecoderState * brotli;
+#endif
+};
+
+#endif // EANSEARCH_COMPRESS_HPP
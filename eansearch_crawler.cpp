@@ -0,0 +1,214 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_crawler.hpp"
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+PrefixCrawler::PrefixCrawler(EANSearch * api, int threads) {
+    this->api = api;
+    this->threads = threads < 1 ? 1 : threads;
+    this->split_threshold = 10;
+    this->language = English;
+    this->active = 0;
+    this->failed = false;
+}
+
+void PrefixCrawler::SetSplitThreshold(int pages)
+{
+    split_threshold = pages < 1 ? 1 : pages;
+}
+
+void PrefixCrawler::SetLanguage(int language)
+{
+    this->language = language;
+}
+
+/**
+ * @brief Load a checkpoint file and open it for appending.
+ *
+ * Each line holds a state and a prefix: "D <prefix>" for a prefix whose
+ * pages were all walked, "S <prefix>" for a prefix that was split into
+ * its children.
+ */
+bool PrefixCrawler::SetCheckpointFile(const string & filename)
+{
+    lock_guard<mutex> guard(checkpoint_lock);
+    ifstream in(filename);
+    string line;
+    while (getline(in, line)) {
+        if (line.size() < 3 || line[1] != ' ') {
+            continue; // ignore a line cut short by an interruption
+        }
+        if (line[0] == 'D') {
+            done.insert(line.substr(2));
+        } else if (line[0] == 'S') {
+            split.insert(line.substr(2));
+        }
+    }
+    if (checkpoint.is_open()) {
+        checkpoint.close();
+    }
+    checkpoint.open(filename, ios::app);
+    return checkpoint.good();
+}
+
+bool PrefixCrawler::Crawl(const string & prefix, ProductCallback callback)
+{
+    this->callback = callback;
+    {
+        lock_guard<mutex> guard(emit_lock);
+        seen.clear();
+    }
+    {
+        lock_guard<mutex> guard(queue_lock);
+        queue.clear();
+        queue.push_back(prefix);
+        active = 0;
+        failed = false;
+    }
+    vector<thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(&PrefixCrawler::Worker, this);
+    }
+    for (auto & t : workers) {
+        t.join();
+    }
+    return !failed;
+}
+
+size_t PrefixCrawler::ProductsFound()
+{
+    lock_guard<mutex> guard(emit_lock);
+    return seen.size();
+}
+
+void PrefixCrawler::Worker()
+{
+    unique_lock<mutex> lk(queue_lock);
+    while (true) {
+        queue_cv.wait(lk, [this] { return !queue.empty() || active == 0; });
+        if (queue.empty()) {
+            return; // no work left and nobody can add more
+        }
+        string prefix = queue.front();
+        queue.pop_front();
+        active++;
+        lk.unlock();
+        bool ok = WalkPrefix(prefix);
+        lk.lock();
+        if (!ok) {
+            failed = true;
+        }
+        active--;
+        if (active == 0 && queue.empty()) {
+            queue_cv.notify_all();
+        }
+    }
+}
+
+/**
+ * @brief Walk the pages of one prefix, or split it into its children.
+ * @return false if an API call failed.
+ */
+bool PrefixCrawler::WalkPrefix(const string & prefix)
+{
+    if (IsDone(prefix)) {
+        return true;
+    }
+    bool is_split;
+    {
+        lock_guard<mutex> guard(checkpoint_lock);
+        is_split = split.count(prefix) > 0;
+    }
+    bool splittable = (int)prefix.size() < MAX_CRAWL_PREFIX_LENGTH;
+    if (!is_split && splittable) {
+        // probe the first page past the threshold, so a prefix that is split
+        // doesn't fetch pages its children fetch again
+        ProductList * pl = api->BarcodePrefixSearch(prefix, language, split_threshold);
+        if (!pl) {
+            return false;
+        }
+        is_split = !pl->empty();
+        DeleteProductList(pl);
+        if (is_split) {
+            Record('S', prefix);
+        }
+    }
+    if (!is_split) {
+        size_t page_size = 0;
+        // the probe found nothing past the threshold
+        for (int page = 0; !splittable || page < split_threshold; page++) {
+            ProductList * pl = api->BarcodePrefixSearch(prefix, language, page);
+            if (!pl) {
+                return false;
+            }
+            size_t count = pl->size();
+            for (auto p : *pl) {
+                Emit(*p);
+            }
+            DeleteProductList(pl);
+            if (page == 0) {
+                page_size = count;
+            }
+            // a page shorter than the first one is the last page
+            if (count == 0 || count < page_size) {
+                break;
+            }
+        }
+        Record('D', prefix);
+        return true;
+    }
+    {
+        lock_guard<mutex> guard(queue_lock);
+        for (char digit = '0'; digit <= '9'; digit++) {
+            queue.push_back(prefix + digit);
+        }
+    }
+    queue_cv.notify_all();
+    return true;
+}
+
+/**
+ * @brief Check if a prefix or one of its ancestors was completed.
+ */
+bool PrefixCrawler::IsDone(const string & prefix)
+{
+    lock_guard<mutex> guard(checkpoint_lock);
+    for (size_t len = prefix.size(); len > 0; len--) {
+        if (done.count(prefix.substr(0, len))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PrefixCrawler::Record(char state, const string & prefix)
+{
+    lock_guard<mutex> guard(checkpoint_lock);
+    if (state == 'D') {
+        done.insert(prefix);
+    } else {
+        split.insert(prefix);
+    }
+    if (checkpoint.is_open()) {
+        checkpoint << state << ' ' << prefix << '\n';
+        checkpoint.flush();
+    }
+}
+
+void PrefixCrawler::Emit(const Product & p)
+{
+    lock_guard<mutex> guard(emit_lock);
+    if (seen.insert(p.ean).second && callback) {
+        callback(p);
+    }
+}
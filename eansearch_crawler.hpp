@@ -0,0 +1,118 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_CRAWLER_HPP
+#define EANSEARCH_CRAWLER_HPP
+
+#include "eansearch.hpp"
+#include <functional>
+#include <fstream>
+#include <deque>
+#include <unordered_set>
+#include <condition_variable>
+using namespace std;
+
+
+/// Prefixes of this length are not split any further (the 13th digit is the checksum)
+const int MAX_CRAWL_PREFIX_LENGTH = 12;
+
+/**
+ * @brief Exhaustive, parallel crawler for all products under a barcode prefix.
+ *
+ * Walks the pages of BarcodePrefixSearch() for a prefix. When a prefix has
+ * more pages than the split threshold, which a request for the first page
+ * past it shows, it is replaced by its ten child prefixes (prefix + "0"
+ * ... prefix + "9") without fetching its own pages; they are walked in
+ * parallel by the worker threads. Requests go through the EANSearch object, so
+ * its rate limit applies to all workers together.
+ *
+ * Progress can be recorded in a checkpoint file; a crawl started with the
+ * same checkpoint file skips every prefix that was already completed.
+ */
+class PrefixCrawler
+{
+public:
+    /// Receives each product found; calls are serialized
+    typedef function<void(const Product & p)> ProductCallback;
+
+    /**
+     * @brief Construct a new PrefixCrawler.
+     * @param api API object used for all requests (not owned).
+     * @param threads Number of worker threads.
+     */
+    PrefixCrawler(EANSearch * api, int threads = 4);
+
+    /**
+     * @brief Set the number of pages after which a prefix is split.
+     * @param pages Page count (default 10).
+     */
+    void SetSplitThreshold(int pages);
+
+    /**
+     * @brief Set the language for product names.
+     * @param language Language enum value (default English).
+     */
+    void SetLanguage(int language);
+
+    /**
+     * @brief Record progress in a checkpoint file and resume from it.
+     * @param filename Checkpoint file; created if it doesn't exist.
+     * @return true if the file could be read and opened for appending.
+     */
+    bool SetCheckpointFile(const string & filename);
+
+    /**
+     * @brief Crawl all products under a prefix.
+     * @param prefix Barcode prefix digits.
+     * @param callback Called once for each distinct product found.
+     * @return true if every prefix was crawled, false if API calls failed
+     *         (a later run with the same checkpoint file retries those prefixes).
+     *
+     * Products of prefixes that were started but not completed before an
+     * interruption may be reported again when the crawl is resumed.
+     */
+    bool Crawl(const string & prefix, ProductCallback callback);
+
+    /**
+     * @brief Number of distinct products reported by the last crawl.
+     */
+    size_t ProductsFound();
+
+private:
+    void Worker();
+    bool WalkPrefix(const string & prefix);
+    bool IsDone(const string & prefix);
+    void Record(char state, const string & prefix);
+    void Emit(const Product & p);
+
+    EANSearch * api;
+    int threads;
+    int split_threshold;
+    int language;
+    ProductCallback callback;
+
+    /// Work queue of prefixes still to crawl
+    mutex queue_lock;
+    condition_variable queue_cv;
+    deque<string> queue;
+    int active;
+    bool failed;
+
+    /// Checkpoint state: completed and split prefixes
+    mutex checkpoint_lock;
+    unordered_set<string> done;
+    unordered_set<string> split;
+    ofstream checkpoint;
+
+    /// EANs already reported
+    mutex emit_lock;
+    unordered_set<string> seen;
+};
+
+#endif // EANSEARCH_CRAWLER_HPP
@@ -0,0 +1,201 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_dns.hpp"
+#include <memory>
+#include <functional>
+#include <boost/asio/steady_timer.hpp>
+
+using namespace std;
+
+namespace net = boost::asio;    // from <boost/asio.hpp>
+using tcp = net::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
+
+ResolverCache::ResolverCache(int ttl_seconds) {
+    this->ttl = chrono::seconds(ttl_seconds);
+    this->stop = false;
+}
+
+ResolverCache::~ResolverCache() {
+    {
+        lock_guard<mutex> guard(lock);
+        stop = true;
+    }
+    wakeup.notify_all();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
+}
+
+vector<tcp::endpoint> ResolverCache::Interleave(const vector<tcp::endpoint> & endpoints)
+{
+    vector<tcp::endpoint> first, other, ordered;
+    if (endpoints.empty()) {
+        return ordered;
+    }
+    for (auto & e : endpoints) {
+        (e.protocol() == endpoints.front().protocol() ? first : other).push_back(e);
+    }
+    for (size_t i = 0; i < first.size() || i < other.size(); i++) {
+        if (i < first.size()) {
+            ordered.push_back(first[i]);
+        }
+        if (i < other.size()) {
+            ordered.push_back(other[i]);
+        }
+    }
+    return ordered;
+}
+
+vector<tcp::endpoint> ResolverCache::Lookup(const string & host, const string & port)
+{
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    vector<tcp::endpoint> endpoints;
+    for (auto & r : resolver.resolve(host, port)) {
+        endpoints.push_back(r.endpoint());
+    }
+    return Interleave(endpoints);
+}
+
+vector<tcp::endpoint> ResolverCache::Resolve(const string & host, const string & port)
+{
+    string key = host + ":" + port;
+    auto now = chrono::steady_clock::now();
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = entries.find(key);
+        if (it != entries.end() && now - it->second.resolved < ttl) {
+            if (now - it->second.resolved >= ttl * 3 / 4 && pending.insert(make_pair(host, port)).second) {
+                if (!refresher.joinable()) {
+                    refresher = thread(&ResolverCache::Refresh, this);
+                }
+                wakeup.notify_one();
+            }
+            return it->second.endpoints;
+        }
+    }
+    try {
+        auto endpoints = Lookup(host, port);
+        lock_guard<mutex> guard(lock);
+        entries[key] = Entry { endpoints, now };
+        return endpoints;
+    }
+    catch(boost::system::system_error const &) {
+        lock_guard<mutex> guard(lock);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            return it->second.endpoints; // expired, but better than nothing
+        }
+        throw;
+    }
+}
+
+/**
+ * @brief Background thread: resolve the pending hosts again.
+ */
+void ResolverCache::Refresh()
+{
+    unique_lock<mutex> guard(lock);
+    for (;;) {
+        wakeup.wait(guard, [this]() { return stop || !pending.empty(); });
+        if (stop) {
+            return;
+        }
+        auto host_port = *pending.begin();
+        guard.unlock();
+        vector<tcp::endpoint> endpoints;
+        try {
+            endpoints = Lookup(host_port.first, host_port.second);
+        }
+        catch(boost::system::system_error const &) {
+            // keep the old addresses, the next request after the TTL tries again
+        }
+        guard.lock();
+        if (!endpoints.empty()) {
+            entries[host_port.first + ":" + host_port.second] = Entry { endpoints, chrono::steady_clock::now() };
+        }
+        pending.erase(host_port);
+    }
+}
+
+void HappyEyeballsConnect(net::io_context & ioc, const vector<tcp::endpoint> & endpoints, tcp::socket & socket,
+                          chrono::steady_clock::duration timeout)
+{
+    vector<unique_ptr<tcp::socket>> attempts;
+    net::steady_timer delay(ioc);
+    net::steady_timer limit(ioc);
+    size_t next = 0;
+    int running = 0;
+    bool connected = false;
+    boost::system::error_code last_error = net::error::host_not_found;
+
+    // all handlers run inside ioc.run() below, so they may use the locals
+    function<void()> start = [&]() {
+        if (connected || next >= endpoints.size()) {
+            return;
+        }
+        attempts.push_back(make_unique<tcp::socket>(ioc));
+        tcp::socket * s = attempts.back().get();
+        running++;
+        s->async_connect(endpoints[next++], [&, s](boost::system::error_code ec) {
+            running--;
+            if (connected) {
+                return;
+            }
+            if (!ec) {
+                connected = true;
+                socket = move(*s);
+                delay.cancel();
+                limit.cancel();
+                for (auto & a : attempts) {
+                    boost::system::error_code ignored;
+                    a->close(ignored);
+                }
+                return;
+            }
+            if (last_error != net::error::timed_out) {
+                last_error = ec;
+            }
+            if (next < endpoints.size()) {
+                start(); // don't wait for the delay after a failure
+            } else if (running == 0) {
+                delay.cancel();
+                limit.cancel();
+            }
+        });
+        delay.expires_after(chrono::milliseconds(CONNECTION_ATTEMPT_DELAY_MS));
+        delay.async_wait([&](boost::system::error_code ec) {
+            if (!ec) {
+                start();
+            }
+        });
+    };
+    if (timeout.count() > 0) {
+        limit.expires_after(timeout);
+        limit.async_wait([&](boost::system::error_code ec) {
+            if (ec || connected) {
+                return;
+            }
+            last_error = net::error::timed_out;
+            next = endpoints.size(); // no more attempts
+            delay.cancel();
+            for (auto & a : attempts) {
+                boost::system::error_code ignored;
+                a->close(ignored);
+            }
+        });
+    }
+    start();
+    ioc.restart();
+    ioc.run();
+    if (!connected) {
+        throw boost::system::system_error(last_error);
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_DNS_HPP
+#define EANSEARCH_DNS_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+using namespace std;
+
+
+/// Seconds a resolved address list is used; getaddrinfo() doesn't report the DNS TTL
+const int DNS_TTL_SECONDS = 60;
+/// Delay before starting the next connection attempt (RFC 8305 recommends 250 ms)
+const int CONNECTION_ATTEMPT_DELAY_MS = 250;
+
+/**
+ * @brief Cache of resolved server addresses with background refresh.
+ *
+ * Addresses are resolved once and reused for the TTL. In the last quarter
+ * of the TTL a background thread resolves them again, so requests never
+ * wait for the resolver while a host is in use. If the resolver fails,
+ * the expired addresses are used rather than failing the request.
+ */
+class ResolverCache
+{
+public:
+    ResolverCache(int ttl_seconds = DNS_TTL_SECONDS);
+    ~ResolverCache();
+
+    /**
+     * @brief Addresses of a host, from the cache if possible.
+     * @param host Host name or address.
+     * @param port Port or service name.
+     * @return Addresses ordered for happy eyeballs; throws boost::system::system_error if unresolvable.
+     */
+    vector<boost::asio::ip::tcp::endpoint> Resolve(const string & host, const string & port);
+
+    /**
+     * @brief Order addresses for happy eyeballs: alternate families, starting with the first one.
+     */
+    static vector<boost::asio::ip::tcp::endpoint> Interleave(const vector<boost::asio::ip::tcp::endpoint> & endpoints);
+
+private:
+    struct Entry {
+        vector<boost::asio::ip::tcp::endpoint> endpoints;
+        chrono::steady_clock::time_point resolved;
+    };
+
+    static vector<boost::asio::ip::tcp::endpoint> Lookup(const string & host, const string & port);
+    void Refresh();
+
+    mutex lock;
+    condition_variable wakeup;
+    chrono::seconds ttl;
+    /// Entries by "host:port"
+    map<string, Entry> entries;
+    /// Keys waiting for a background refresh
+    set<pair<string, string>> pending;
+    thread refresher;
+    bool stop;
+};
+
+/**
+ * @brief Connect a socket to the first address that answers (RFC 8305).
+ * @param ioc I/O context of the socket, not running.
+ * @param endpoints Addresses in the order returned by ResolverCache::Resolve().
+ * @param socket Receives the connected socket.
+ * @param timeout Limit for all attempts together, zero for none.
+ *
+ * Attempts start CONNECTION_ATTEMPT_DELAY_MS apart, or as soon as the
+ * previous one fails; the first attempt to succeed wins and the others
+ * are cancelled. Throws boost::system::system_error if all attempts fail
+ * or the timeout expires (timed_out).
+ */
+void HappyEyeballsConnect(boost::asio::io_context & ioc, const vector<boost::asio::ip::tcp::endpoint> & endpoints,
+                          boost::asio::ip::tcp::socket & socket,
+                          chrono::steady_clock::duration timeout = chrono::steady_clock::duration::zero());
+
+#endif // EANSEARCH_DNS_HPP
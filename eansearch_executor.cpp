@@ -0,0 +1,419 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_executor.hpp"
+#include "eansearch_codec.hpp"
+#include "eansearch_snapshot.hpp"
+#include "eansearch_textindex.hpp"
+#include "eansearch_similarity.hpp"
+#include "eansearch_budget.hpp"
+#include <array>
+#include <boost/json.hpp>
+
+using namespace std;
+
+namespace json = boost::json;   // from <boost/json.hpp>
+
+/// Pool and index of the worker running on this thread, see WorkStealingPool::Post()
+static thread_local const WorkStealingPool * current_pool = nullptr;
+static thread_local int current_worker = -1;
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    if (threads <= 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    this->count = threads;
+    this->workers = new Worker[threads];
+    this->stop = false;
+    this->queued = 0;
+    this->next = 0;
+    this->executed = 0;
+    this->stolen = 0;
+    for (int i = 0; i < threads; i++) {
+        this->threads.emplace_back(&WorkStealingPool::Run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> guard(idle_lock);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto & t : threads) {
+        t.join();
+    }
+    delete[] workers;
+}
+
+void WorkStealingPool::Post(Task task)
+{
+    int index = current_pool == this ? current_worker : (int)(next.fetch_add(1, memory_order_relaxed) % count);
+    {
+        lock_guard<mutex> guard(workers[index].lock);
+        workers[index].tasks.push_back(move(task));
+    }
+    {
+        // under the lock, so a worker can't miss it between its check and its wait
+        lock_guard<mutex> guard(idle_lock);
+        queued++;
+    }
+    wake.notify_one();
+}
+
+int WorkStealingPool::Threads() const
+{
+    return count;
+}
+
+ExecutorStats WorkStealingPool::Stats() const
+{
+    return ExecutorStats { executed.load(memory_order_relaxed), stolen.load(memory_order_relaxed),
+                           queued.load(memory_order_relaxed) };
+}
+
+void WorkStealingPool::Run(int index)
+{
+    current_pool = this;
+    current_worker = index;
+    Task task;
+    while (true) {
+        if (Take(index, task)) {
+            queued--;
+            task();
+            task = nullptr; // release what the task holds before waiting
+            executed.fetch_add(1, memory_order_relaxed);
+            continue;
+        }
+        unique_lock<mutex> guard(idle_lock);
+        // queued tasks another worker is about to take wake us only briefly
+        wake.wait(guard, [this]() { return queued > 0 || stop; });
+        if (stop && queued == 0) {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::Take(int index, Task & task)
+{
+    {
+        Worker & own = workers[index];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (int i = 1; i < count; i++) {
+        Worker & victim = workers[(index + i) % count];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            stolen.fetch_add(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Decode base64 data; characters outside the alphabet, like padding and line breaks, are skipped.
+ */
+static string DecodeBase64(const string & data) {
+    static const array<int8_t, 256> VALUES = []() {
+        array<int8_t, 256> values;
+        values.fill(-1);
+        const char * alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < 64; i++) {
+            values[(unsigned char)alphabet[i]] = i;
+        }
+        return values;
+    }();
+    string out;
+    out.reserve(data.size() / 4 * 3);
+    uint32_t bits = 0;
+    int pending = 0;
+    for (unsigned char c : data) {
+        int value = VALUES[c];
+        if (value < 0) {
+            continue;
+        }
+        bits = bits << 6 | value;
+        pending += 6;
+        if (pending >= 8) {
+            pending -= 8;
+            out += (char)(bits >> pending & 0xff);
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief A string field of the first element of a JSON response.
+ */
+static string FirstField(const string & result, const char * name) {
+    return json::parse(result).at(0).at(name).as_string().c_str();
+}
+
+AsyncEANSearch::AsyncEANSearch(EANSearch * api, WorkStealingPool * cpu, int io_threads) {
+    this->api = api;
+    this->own_cpu = cpu == nullptr;
+    this->cpu = cpu ? cpu : new WorkStealingPool();
+    this->io = new WorkStealingPool(io_threads < 1 ? 1 : io_threads);
+    this->calls = 0;
+}
+
+AsyncEANSearch::~AsyncEANSearch() {
+    // tasks of a call move between the pools, so neither can be drained first
+    unique_lock<mutex> guard(calls_lock);
+    calls_done.wait(guard, [this]() { return calls == 0; });
+    guard.unlock();
+    delete io;
+    if (own_cpu) {
+        delete cpu;
+    }
+}
+
+void AsyncEANSearch::Started()
+{
+    lock_guard<mutex> guard(calls_lock);
+    calls++;
+}
+
+void AsyncEANSearch::Finished()
+{
+    // notified under the lock, the destructor can't return before
+    lock_guard<mutex> guard(calls_lock);
+    if (--calls == 0) {
+        calls_done.notify_all();
+    }
+}
+
+WorkStealingPool & AsyncEANSearch::CpuPool()
+{
+    return *cpu;
+}
+
+template <class T>
+future<T> AsyncEANSearch::Run(const string & params, bool cached, function<bool(T &)> local,
+                              function<T(const string &)> parse, T failed)
+{
+    auto promise = make_shared<std::promise<T>>();
+    auto result = promise->get_future();
+    Priority priority = ScopedPriority::Current();
+    string tag = ScopedCallerTag::Current();
+    Started();
+    auto request = [this, params, cached, parse, failed, promise, priority, tag]() {
+        ScopedPriority scoped_priority(priority);
+        ScopedCallerTag scoped_tag(tag);
+        auto response = make_shared<string>();
+        if (!(cached ? api->CachedAPICall(params, *response) : api->APICall(params, *response))) {
+            promise->set_value(failed);
+            Finished();
+            return;
+        }
+        cpu->Post([this, params, parse, failed, promise, response]() {
+            T value = failed;
+            {
+                RequestTimer timer(api->metrics, OpOf(params));
+                try {
+                    value = parse(*response);
+                }
+                catch(std::exception const &) {
+                    // a malformed response fails the call
+                }
+                timer.Mark(PhaseParse);
+            }
+            promise->set_value(move(value));
+            Finished();
+        });
+    };
+    if (!local) {
+        io->Post(request);
+        return result;
+    }
+    cpu->Post([this, local, request, promise]() {
+        T value {};
+        if (local(value)) {
+            promise->set_value(move(value));
+            Finished();
+        } else {
+            io->Post(request);
+        }
+    });
+    return result;
+}
+
+future<ProductFull *> AsyncEANSearch::BarcodeLookup(const string & ean, int language)
+{
+    function<bool(ProductFull * &)> local;
+    if (api->snapshot && api->snapshot->Language() == language) {
+        local = [this, ean](ProductFull * & p) { return (p = api->snapshot->Lookup(ean)) != nullptr; };
+    }
+    string params;
+    BarcodeLookupParams(params, ean, language);
+    return Run<ProductFull *>(params, true, local, ParseBarcode, nullptr);
+}
+
+future<vector<ProductFull *>> AsyncEANSearch::BatchBarcodeLookup(const vector<string> & eans, int language)
+{
+    struct Batch {
+        vector<ProductFull *> products;
+        vector<string> params;
+        vector<size_t> positions; // of params in eans
+        vector<string> results;
+        atomic<int> chunks;
+        std::promise<vector<ProductFull *>> promise;
+    };
+    auto batch = make_shared<Batch>();
+    batch->products.assign(eans.size(), nullptr);
+    auto result = batch->promise.get_future();
+    Priority priority = ScopedPriority::Current();
+    string tag = ScopedCallerTag::Current();
+    Started();
+    cpu->Post([this, eans, language, batch, priority, tag]() {
+        bool local = api->snapshot && api->snapshot->Language() == language;
+        for (size_t i = 0; i < eans.size(); i++) {
+            if (local && (batch->products[i] = api->snapshot->Lookup(eans[i]))) {
+                continue;
+            }
+            batch->params.emplace_back();
+            BarcodeLookupParams(batch->params.back(), eans[i], language);
+            batch->positions.push_back(i);
+        }
+        if (batch->params.empty()) {
+            batch->promise.set_value(move(batch->products));
+            Finished();
+            return;
+        }
+        io->Post([this, batch, priority, tag]() {
+            ScopedPriority scoped_priority(priority);
+            ScopedCallerTag scoped_tag(tag);
+            // cached responses are parsed with the others, the rest goes out in one batch
+            api->CachedQueryBatch(batch->params, batch->results);
+            size_t size = batch->results.size();
+            batch->chunks = (int)((size + ASYNC_PARSE_CHUNK - 1) / ASYNC_PARSE_CHUNK);
+            for (size_t start = 0; start < size; start += ASYNC_PARSE_CHUNK) {
+                cpu->Post([this, batch, start, size]() {
+                    for (size_t j = start; j < min(size, start + ASYNC_PARSE_CHUNK); j++) {
+                        if (batch->results[j].empty()) {
+                            continue;
+                        }
+                        RequestTimer timer(api->metrics, "barcode-lookup");
+                        batch->products[batch->positions[j]] = ParseBarcode(batch->results[j]);
+                        timer.Mark(PhaseParse);
+                    }
+                    if (--batch->chunks == 0) {
+                        batch->promise.set_value(move(batch->products));
+                        Finished();
+                    }
+                });
+            }
+        });
+    });
+    return result;
+}
+
+future<ProductFull *> AsyncEANSearch::IsbnLookup(const string & isbn)
+{
+    string params;
+    IsbnLookupParams(params, isbn);
+    return Run<ProductFull *>(params, true, nullptr, ParseBarcode, nullptr);
+}
+
+future<bool> AsyncEANSearch::VerifyChecksum(const string & ean)
+{
+    string params;
+    VerifyChecksumParams(params, ean);
+    return Run<bool>(params, false, nullptr,
+                     [](const string & result) { return FirstField(result, "valid") == "1"; }, false);
+}
+
+future<ProductList *> AsyncEANSearch::ProductSearch(const string & name, int only_language, int page)
+{
+    function<bool(ProductList * &)> local;
+    if (api->index && (only_language == Any || only_language == api->index->Language())) {
+        local = [this, name, page](ProductList * & pl) {
+            return (pl = api->index->Search(name, -1, page, api->index_page_size)) != nullptr;
+        };
+    }
+    string params;
+    SearchParams(params, "op=product-search&name=", name, only_language, page);
+    return Run<ProductList *>(params, false, local, ParseProductList, nullptr);
+}
+
+future<ProductList *> AsyncEANSearch::SimilarProductSearch(const string & name, int only_language, int page)
+{
+    function<bool(ProductList * &)> local;
+    if (api->similarity && (only_language == Any || only_language == api->similarity->Language())) {
+        local = [this, name, page](ProductList * & pl) {
+            return (pl = api->similarity->Search(name, page, api->similarity_page_size)) != nullptr;
+        };
+    }
+    string params;
+    SearchParams(params, "op=similar-product-search&name=", name, only_language, page);
+    return Run<ProductList *>(params, false, local, ParseProductList, nullptr);
+}
+
+future<ProductList *> AsyncEANSearch::CategorySearch(int category, const string & name, int only_language, int page)
+{
+    function<bool(ProductList * &)> local;
+    if (api->index && (only_language == Any || only_language == api->index->Language())) {
+        local = [this, category, name, page](ProductList * & pl) {
+            return (pl = api->index->Search(name, category, page, api->index_page_size)) != nullptr;
+        };
+    }
+    string params;
+    CategorySearchParams(params, category, name, only_language, page);
+    return Run<ProductList *>(params, false, local, ParseProductList, nullptr);
+}
+
+future<ProductList *> AsyncEANSearch::BarcodePrefixSearch(const string & prefix, int language, int page)
+{
+    function<bool(ProductList * &)> local;
+    if (api->snapshot && api->snapshot->Language() == language) {
+        local = [this, prefix, page](ProductList * & pl) {
+            return (pl = api->snapshot->PrefixSearch(prefix, page, api->snapshot_page_size)) != nullptr;
+        };
+    }
+    string params;
+    PrefixSearchParams(params, prefix, language, page);
+    return Run<ProductList *>(params, false, local, ParseProductList, nullptr);
+}
+
+future<string> AsyncEANSearch::IssuingCountryLookup(const string & ean)
+{
+    string params;
+    IssuingCountryParams(params, ean);
+    return Run<string>(params, true, nullptr,
+                       [](const string & result) { return FirstField(result, "issuingCountry"); }, string());
+}
+
+future<string> AsyncEANSearch::BarcodeImage(const string & ean, int width, int height)
+{
+    string params;
+    BarcodeImageParams(params, ean, width, height);
+    return Run<string>(params, false, nullptr, [](const string & result) { return FirstField(result, "barcode"); },
+                       string());
+}
+
+future<string> AsyncEANSearch::BarcodePNG(const string & ean, int width, int height)
+{
+    string params;
+    BarcodeImageParams(params, ean, width, height);
+    return Run<string>(params, false, nullptr,
+                       [](const string & result) { return DecodeBase64(FirstField(result, "barcode")); }, string());
+}
+
+future<string> AsyncEANSearch::Query(const string & params)
+{
+    return Run<string>(params, false, nullptr, [](const string & result) { return result; }, string());
+}
@@ -0,0 +1,201 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_EXECUTOR_HPP
+#define EANSEARCH_EXECUTOR_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+#include "eansearch.hpp"
+using namespace std;
+
+
+/// Threads of an AsyncEANSearch that wait for API responses, by default
+const int ASYNC_IO_THREADS = 16;
+/// Responses of a batch parsed by one task, the others can be stolen meanwhile
+const int ASYNC_PARSE_CHUNK = 64;
+
+/**
+ * @brief Counters of a WorkStealingPool.
+ */
+struct ExecutorStats {
+    /// Tasks run
+    uint64_t executed;
+    /// Tasks a worker took from another worker's deque
+    uint64_t stolen;
+    /// Tasks posted but not started yet
+    int64_t queued;
+};
+
+/**
+ * @brief Thread pool with a task deque per thread and work stealing.
+ *
+ * A task posted from one of the workers goes to the back of that
+ * worker's deque, others are spread round-robin over the deques. Each
+ * worker takes its newest task from the back of its own deque, where the
+ * data of the task that posted it is still in its cache, and when it has
+ * none left it steals the oldest task from the front of another deque.
+ * The deques have a lock each, so workers only contend while stealing.
+ *
+ * A task must not wait for a task of the same pool, all workers could be
+ * waiting then.
+ */
+class WorkStealingPool
+{
+public:
+    typedef function<void()> Task;
+
+    /**
+     * @brief Start the workers.
+     * @param threads Number of workers, 0 for one per core.
+     */
+    WorkStealingPool(int threads = 0);
+
+    /**
+     * @brief Run the tasks posted so far, then stop the workers.
+     */
+    ~WorkStealingPool();
+
+    /**
+     * @brief Run a task on one of the workers.
+     */
+    void Post(Task task);
+
+    /**
+     * @brief Run a function on one of the workers.
+     * @return Future of its result.
+     */
+    template <class F>
+    auto Submit(F f) -> future<decltype(f())>
+    {
+        auto task = make_shared<packaged_task<decltype(f())()>>(move(f));
+        auto result = task->get_future();
+        Post([task]() { (*task)(); });
+        return result;
+    }
+
+    int Threads() const;
+
+    ExecutorStats Stats() const;
+
+private:
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool & operator=(const WorkStealingPool &) = delete;
+
+    struct Worker {
+        mutex lock;
+        deque<Task> tasks;
+    };
+
+    void Run(int index);
+    /// Take a task from the back of the own deque, or the front of another one
+    bool Take(int index, Task & task);
+
+    int count;
+    Worker * workers;
+    vector<thread> threads;
+    /// Sleeping workers wait for queued tasks
+    mutex idle_lock;
+    condition_variable wake;
+    bool stop;
+    atomic<int64_t> queued;
+    atomic<uint64_t> next;
+    atomic<uint64_t> executed;
+    atomic<uint64_t> stolen;
+};
+
+/**
+ * @brief Asynchronous API calls for callers without an executor of their own.
+ *
+ * Each call returns a future right away. Lookups in a local snapshot or
+ * index, JSON parsing and base64 decoding run on a WorkStealingPool with
+ * a worker per core, while the requests themselves wait for the server on
+ * separate I/O threads: a request blocks its thread on the io_context of
+ * its connection, so CPU work never queues behind a slow response. The
+ * priority (ScopedPriority) and caller tag (ScopedCallerTag) of the
+ * calling thread go with the call.
+ *
+ * Results are owned by the caller as with EANSearch. The object must
+ * outlive the pool passed as cpu, and its destructor waits until every
+ * call has delivered its result.
+ */
+class AsyncEANSearch
+{
+public:
+    /**
+     * @brief Construct a new AsyncEANSearch.
+     * @param api API object used for all requests (not owned).
+     * @param cpu Pool for the CPU work (not owned), nullptr for a pool of its own.
+     * @param io_threads Requests waiting for a response at a time.
+     */
+    AsyncEANSearch(EANSearch * api, WorkStealingPool * cpu = nullptr, int io_threads = ASYNC_IO_THREADS);
+
+    /**
+     * @brief Wait for the calls in progress, then stop the I/O threads.
+     */
+    ~AsyncEANSearch();
+
+    future<ProductFull *> BarcodeLookup(const string & ean, int language = English);
+    /// Responses are parsed by several workers in parallel
+    future<vector<ProductFull *>> BatchBarcodeLookup(const vector<string> & eans, int language = English);
+    future<ProductFull *> IsbnLookup(const string & isbn);
+    future<bool> VerifyChecksum(const string & ean);
+    future<ProductList *> ProductSearch(const string & name, int only_language = Any, int page = 0);
+    future<ProductList *> SimilarProductSearch(const string & name, int only_language = Any, int page = 1);
+    future<ProductList *> CategorySearch(int category, const string & name, int only_language = Any, int page = 0);
+    future<ProductList *> BarcodePrefixSearch(const string & prefix, int language = English, int page = 0);
+    future<string> IssuingCountryLookup(const string & ean);
+    /// Base64-encoded PNG data, as EANSearch::BarcodeImage()
+    future<string> BarcodeImage(const string & ean, int width = 102, int height = 50);
+    /// Binary PNG data, decoded on the CPU pool; empty on error
+    future<string> BarcodePNG(const string & ean, int width = 102, int height = 50);
+    /// Raw JSON response, empty on error, see EANSearch::Query()
+    future<string> Query(const string & params);
+
+    WorkStealingPool & CpuPool();
+
+private:
+    AsyncEANSearch(const AsyncEANSearch &) = delete;
+    AsyncEANSearch & operator=(const AsyncEANSearch &) = delete;
+
+    /**
+     * @brief Try local, else send params on an I/O thread and parse the response on the CPU pool.
+     * @param local Answers from a local snapshot or index on the CPU pool; empty to go to the API.
+     * @param cached Whether the response may come from the cache.
+     * @param failed Result on error.
+     */
+    template <class T>
+    future<T> Run(const string & params, bool cached, function<bool(T &)> local,
+                  function<T(const string &)> parse, T failed);
+
+    /// Count a call the destructor has to wait for
+    void Started();
+    /// Last access of a call to this object, after its promise is set
+    void Finished();
+
+    EANSearch * api;
+    WorkStealingPool * cpu;
+    bool own_cpu;
+    WorkStealingPool * io;
+    /// Calls whose tasks may still use this object
+    int calls;
+    mutex calls_lock;
+    condition_variable calls_done;
+};
+
+#endif // EANSEARCH_EXECUTOR_HPP
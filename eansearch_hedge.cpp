@@ -0,0 +1,179 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_hedge.hpp"
+#include <algorithm>
+#include <boost/asio/post.hpp>
+
+using namespace std;
+
+bool CancelSlot::Attach(Connection * c)
+{
+    lock_guard<mutex> guard(lock);
+    this->c = c;
+    return !cancelled;
+}
+
+bool CancelSlot::Detach()
+{
+    lock_guard<mutex> guard(lock);
+    c = nullptr;
+    return cancelled;
+}
+
+void CancelSlot::Cancel()
+{
+    lock_guard<mutex> guard(lock);
+    cancelled = true;
+    if (c) {
+        Connection * target = c;
+        net::post(target->ioc, [target]() { beast::get_lowest_layer(target->stream).cancel(); });
+    }
+}
+
+bool CancelSlot::Cancelled()
+{
+    lock_guard<mutex> guard(lock);
+    return cancelled;
+}
+
+Hedger::Hedger(double percentile, double max_extra_percent, Send send) : window(HEDGE_WINDOW) {
+    this->percentile = percentile;
+    this->max_extra_percent = max_extra_percent;
+    this->send = send;
+    this->recorded = 0;
+    this->delay = -1;
+    this->calls = 0;
+    this->hedges = 0;
+    this->stop = false;
+    for (int i = 0; i < HEDGE_WORKERS; i++) {
+        workers.emplace_back(&Hedger::Work, this);
+    }
+}
+
+Hedger::~Hedger() {
+    {
+        lock_guard<mutex> guard(lock);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto & w : workers) {
+        w.join();
+    }
+}
+
+void Hedger::Schedule(const shared_ptr<HedgedCall> & call)
+{
+    calls++;
+    int64_t micros = delay.load(memory_order_relaxed);
+    if (micros < 0) {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        queue.emplace(chrono::steady_clock::now() + chrono::microseconds(micros), call);
+    }
+    wake.notify_one();
+}
+
+bool Hedger::Settle(HedgedCall & call, bool answered)
+{
+    unique_lock<mutex> guard(call.lock);
+    if (!answered && !call.done) {
+        // the hedge may still get an answer
+        call.settled.wait(guard, [&call]() { return !call.running; });
+    }
+    if (call.hedge_won) {
+        return true;
+    }
+    call.done = true;
+    call.hedge.Cancel();
+    return false;
+}
+
+void Hedger::Record(chrono::microseconds latency)
+{
+    lock_guard<mutex> guard(window_lock);
+    window[recorded % window.size()] = (uint32_t)min<int64_t>(latency.count(), UINT32_MAX);
+    recorded++;
+    if (recorded < (size_t)HEDGE_MIN_SAMPLES || recorded % HEDGE_UPDATE_INTERVAL != 0) {
+        return;
+    }
+    vector<uint32_t> sorted(window.begin(), window.begin() + min(recorded, window.size()));
+    auto nth = sorted.begin() + min(sorted.size() - 1, (size_t)(percentile / 100 * sorted.size()));
+    nth_element(sorted.begin(), nth, sorted.end());
+    delay = *nth;
+}
+
+chrono::microseconds Hedger::Delay() const
+{
+    return chrono::microseconds(delay.load(memory_order_relaxed));
+}
+
+void Hedger::Work()
+{
+    unique_lock<mutex> guard(lock);
+    while (!stop) {
+        if (queue.empty()) {
+            wake.wait(guard);
+            continue;
+        }
+        if (queue.top().first > chrono::steady_clock::now()) {
+            wake.wait_until(guard, queue.top().first);
+            continue;
+        }
+        auto call = queue.top().second;
+        queue.pop();
+        guard.unlock();
+        Fire(call);
+        guard.lock();
+    }
+}
+
+void Hedger::Fire(const shared_ptr<HedgedCall> & call)
+{
+    {
+        lock_guard<mutex> guard(call->lock);
+        if (call->done) {
+            return;
+        }
+        // reserve the hedge within the budget
+        if ((hedges + 1) * 100 > calls * max_extra_percent) {
+            return;
+        }
+        hedges++;
+        call->running = true;
+    }
+    int status = 0;
+    string output, credits;
+    bool sent = false;
+    auto start = chrono::steady_clock::now();
+    try {
+        sent = send(*call, status, output, credits);
+    }
+    catch(std::exception const &) {
+        // counted by send(), the first request may still answer
+        sent = true;
+    }
+    if (!sent) {
+        hedges--;
+    }
+    lock_guard<mutex> guard(call->lock);
+    call->running = false;
+    if (!call->done && status == 200) {
+        call->done = true;
+        call->hedge_won = true;
+        call->status = status;
+        call->latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+        call->output.swap(output);
+        call->credits.swap(credits);
+        call->primary.Cancel();
+    }
+    call->settled.notify_all();
+}
@@ -0,0 +1,176 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_HEDGE_HPP
+#define EANSEARCH_HEDGE_HPP
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include "eansearch_pool.hpp"
+using namespace std;
+
+
+/// Recent latencies the hedge delay is computed from
+const int HEDGE_WINDOW = 1024;
+/// Latencies recorded before the first hedge is sent
+const int HEDGE_MIN_SAMPLES = 32;
+/// The hedge delay is computed again after this many latencies
+const int HEDGE_UPDATE_INTERVAL = 64;
+/// Threads sending hedge requests, which also limits how many run at a time
+const int HEDGE_WORKERS = 4;
+
+/**
+ * @brief Aborts the request on a connection from another thread.
+ *
+ * The request attaches the connection it uses; Cancel() posts a cancel of
+ * the pending operation to the connection's io_context, so it runs on the
+ * thread doing the I/O. A connection that was cancelled must not be
+ * reused, the posted cancel could hit the next request otherwise.
+ */
+class CancelSlot
+{
+public:
+    CancelSlot() : c(nullptr), cancelled(false) { }
+
+    /**
+     * @brief Attach the connection of the request.
+     * @return false if the request was cancelled already.
+     */
+    bool Attach(Connection * c);
+
+    /**
+     * @brief Detach the connection before it is released.
+     * @return true if the request was cancelled, the connection must be closed then.
+     */
+    bool Detach();
+
+    void Cancel();
+    bool Cancelled();
+
+private:
+    mutex lock;
+    Connection * c;
+    bool cancelled;
+};
+
+/**
+ * @brief A call that may be sent twice, shared by its caller and the hedge worker.
+ */
+struct HedgedCall {
+    string target;
+    chrono::steady_clock::time_point deadline;
+    /// Cancel the first request, and the hedge
+    CancelSlot primary;
+    CancelSlot hedge;
+
+    mutex lock;
+    condition_variable settled;
+    /// The call has an answer, or its caller gave up; no hedge is sent after that
+    bool done = false;
+    /// The hedge is being sent
+    bool running = false;
+    /// The hedge answered first, its response and latency are below
+    bool hedge_won = false;
+    int status = 0;
+    chrono::microseconds latency;
+    string output;
+    string credits;
+};
+
+/**
+ * @brief Sends a second request for slow calls and takes the first answer.
+ *
+ * Each call is scheduled when its first request goes out. If it has not
+ * been answered after the configured percentile of recent latencies, a
+ * worker sends the same request on another connection. Whichever answers
+ * first wins and the other request is cancelled. Hedges are limited to a
+ * share of the calls, since each one costs a credit.
+ */
+class Hedger
+{
+public:
+    /**
+     * @brief Send the hedge of a call.
+     * @return false if it was not sent, e.g. because the rate limit has no token; throws on errors.
+     */
+    typedef function<bool(HedgedCall & call, int & status, string & output, string & credits)> Send;
+
+    /**
+     * @param percentile Percentile of recent latencies after which a call is hedged.
+     * @param max_extra_percent Hedges as a percentage of all calls at most.
+     * @param send Sends a hedge, called on a worker thread.
+     */
+    Hedger(double percentile, double max_extra_percent, Send send);
+    ~Hedger();
+
+    /**
+     * @brief Schedule the hedge of a call whose first request is about to be sent.
+     */
+    void Schedule(const shared_ptr<HedgedCall> & call);
+
+    /**
+     * @brief Settle a call after its first request.
+     * @param answered The first request got a response.
+     * @return true if the hedge answered first, its response is in the call.
+     *
+     * A call whose first request failed waits for a running hedge.
+     * Otherwise the hedge is cancelled, or not sent at all.
+     */
+    bool Settle(HedgedCall & call, bool answered);
+
+    /**
+     * @brief Record the latency of an answered call.
+     */
+    void Record(chrono::microseconds latency);
+
+    /**
+     * @brief Current hedge delay, negative while too few latencies are known.
+     */
+    chrono::microseconds Delay() const;
+
+private:
+    Hedger(const Hedger &) = delete;
+    Hedger & operator=(const Hedger &) = delete;
+
+    void Work();
+    void Fire(const shared_ptr<HedgedCall> & call);
+
+    typedef pair<chrono::steady_clock::time_point, shared_ptr<HedgedCall>> Due;
+    struct Later {
+        bool operator()(const Due & a, const Due & b) const { return a.first > b.first; }
+    };
+
+    double percentile;
+    double max_extra_percent;
+    Send send;
+
+    mutable mutex window_lock;
+    vector<uint32_t> window;
+    size_t recorded;
+    atomic<int64_t> delay;
+
+    atomic<uint64_t> calls;
+    atomic<uint64_t> hedges;
+
+    mutex lock;
+    condition_variable wake;
+    priority_queue<Due, vector<Due>, Later> queue;
+    bool stop;
+    vector<thread> workers;
+};
+
+#endif // EANSEARCH_HEDGE_HPP
@@ -0,0 +1,510 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_http2.hpp"
+
+#ifdef EANSEARCH_HTTP2
+
+#include <cstring>
+#include <array>
+#include <map>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <nghttp2/nghttp2.h>
+
+using namespace std;
+
+/**
+ * @brief State of one request while its stream is open.
+ *
+ * Shared by the calling thread, which waits for done, and the I/O thread
+ * of the session, which writes the response until then. A caller that
+ * runs out of time stops waiting and leaves the stream to the session.
+ */
+struct Http2Stream {
+    string path;
+    /// Guards timer against the caller giving up
+    mutex lock;
+    /// Timer of the caller, nullptr once it stopped waiting
+    RequestTimer * timer;
+    int32_t id = 0;
+    int status = 0;
+    string credits;
+    string encoding;
+    string body;
+    uint32_t error = 0;
+    /// The session failed before the stream was closed
+    bool lost = false;
+    promise<void> done;
+};
+
+/**
+ * @brief Call f with the caller's timer of a stream, unless the caller stopped waiting.
+ */
+template <class F>
+static void WithTimer(Http2Stream * s, F f) {
+    lock_guard<mutex> guard(s->lock);
+    if (s->timer) {
+        f(*s->timer);
+    }
+}
+
+/**
+ * @brief One TLS connection with an nghttp2 client session and its I/O thread.
+ *
+ * nghttp2 sessions aren't thread-safe, so everything that touches the
+ * session runs on the I/O thread; callers post their requests to it.
+ */
+class Http2Session
+{
+public:
+    Http2Session(ssl::context & ctx, const string & host, const string & port);
+    ~Http2Session();
+
+    /**
+     * @brief Resolve, connect and handshake, then start the I/O thread.
+     * @return false if the server doesn't negotiate HTTP/2; throws on errors.
+     */
+    bool Connect(ResolverCache & resolver, const Http2Timeouts & timeouts, RequestTimer & timer);
+
+    /**
+     * @brief Send a GET request for s->path and wait until its stream is closed.
+     * @param timeout Limit for the stream, zero for none; the stream is reset when it expires.
+     */
+    void Get(const shared_ptr<Http2Stream> & s, chrono::steady_clock::duration timeout);
+
+    /// false once the connection failed or the server sent GOAWAY
+    bool Alive() const { return alive; }
+
+    const string host;
+    const string port;
+
+private:
+    static int OnBeginHeaders(nghttp2_session *, const nghttp2_frame * frame, void * user_data);
+    static int OnHeader(nghttp2_session *, const nghttp2_frame * frame, const uint8_t * name, size_t namelen,
+                        const uint8_t * value, size_t valuelen, uint8_t flags, void * user_data);
+    static int OnData(nghttp2_session *, uint8_t flags, int32_t stream_id, const uint8_t * data, size_t len, void * user_data);
+    static int OnFrameSend(nghttp2_session *, const nghttp2_frame * frame, void * user_data);
+    static int OnFrameRecv(nghttp2_session *, const nghttp2_frame * frame, void * user_data);
+    static int OnStreamClose(nghttp2_session *, int32_t stream_id, uint32_t error_code, void * user_data);
+
+    Http2Stream * StreamOf(int32_t stream_id);
+    void Read();
+    void Flush();
+    void Fail();
+
+    net::io_context ioc;
+    optional<net::executor_work_guard<net::io_context::executor_type>> work;
+    ssl::stream<beast::tcp_stream> stream;
+    nghttp2_session * session;
+    thread io;
+    atomic<bool> alive;
+    /// Set on the I/O thread once the connection is closed
+    bool closed;
+    /// Streams not closed yet, only used on the I/O thread
+    map<Http2Stream *, shared_ptr<Http2Stream>> open;
+    array<char, 16384> input;
+    /// Frames being written, not touched until the write completes
+    string output;
+    bool writing;
+    string authority;
+    string accept_encoding;
+};
+
+Http2Session::Http2Session(ssl::context & ctx, const string & host, const string & port)
+    : host(host), port(port), stream(ioc, ctx) {
+    this->session = nullptr;
+    this->alive = false;
+    this->closed = false;
+    this->writing = false;
+    this->authority = port == "443" ? host : host + ":" + port;
+    this->accept_encoding = Decompressor::AcceptEncoding();
+}
+
+Http2Session::~Http2Session() {
+    if (io.joinable()) {
+        net::post(ioc, [this]() {
+            Fail();
+            work.reset();
+        });
+        io.join();
+    }
+    if (session) {
+        nghttp2_session_del(session);
+    }
+}
+
+bool Http2Session::Connect(ResolverCache & resolver, const Http2Timeouts & timeouts, RequestTimer & timer)
+{
+    auto native = stream.native_handle();
+    if (!SSL_set_tlsext_host_name(native, host.c_str())) { // set SNI
+        boost::system::error_code ec{static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()};
+        throw boost::system::system_error{ec};
+    }
+    stream.set_verify_callback(ssl::host_name_verification(host));
+    static const unsigned char ALPN[] = { 2, 'h', '2' };
+    SSL_set_alpn_protos(native, ALPN, sizeof(ALPN));
+    auto const endpoints = resolver.Resolve(host, port);
+    timer.Mark(PhaseResolve);
+    HappyEyeballsConnect(ioc, endpoints, beast::get_lowest_layer(stream).socket(), timeouts.connect);
+    timer.Mark(PhaseConnect);
+    // asynchronous, so the timeout applies
+    beast::error_code ec;
+    if (timeouts.handshake.count() > 0) {
+        beast::get_lowest_layer(stream).expires_after(timeouts.handshake);
+    }
+    stream.async_handshake(ssl::stream_base::client, [&ec](beast::error_code e) { ec = e; });
+    ioc.restart();
+    ioc.run();
+    if (ec) {
+        throw boost::system::system_error{ec};
+    }
+    beast::get_lowest_layer(stream).expires_never();
+    timer.Mark(PhaseHandshake);
+    const unsigned char * protocol = nullptr;
+    unsigned int length = 0;
+    SSL_get0_alpn_selected(native, &protocol, &length);
+    if (length != 2 || memcmp(protocol, "h2", 2) != 0) {
+        return false;
+    }
+    beast::get_lowest_layer(stream).socket().set_option(tcp::no_delay(true), ec);
+
+    nghttp2_session_callbacks * callbacks;
+    nghttp2_session_callbacks_new(&callbacks);
+    nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, OnBeginHeaders);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, OnHeader);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, OnData);
+    nghttp2_session_callbacks_set_on_frame_send_callback(callbacks, OnFrameSend);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, OnFrameRecv);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, OnStreamClose);
+    int rv = nghttp2_session_client_new(&session, callbacks, this);
+    nghttp2_session_callbacks_del(callbacks);
+    if (rv != 0) {
+        throw runtime_error(string("HTTP/2 session: ") + nghttp2_strerror(rv));
+    }
+    nghttp2_settings_entry settings[] = {
+        { NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, HTTP2_MAX_STREAMS },
+        { NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, HTTP2_STREAM_WINDOW },
+        { NGHTTP2_SETTINGS_ENABLE_PUSH, 0 }
+    };
+    nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, settings, sizeof(settings) / sizeof(settings[0]));
+    nghttp2_session_set_local_window_size(session, NGHTTP2_FLAG_NONE, 0, HTTP2_CONNECTION_WINDOW);
+
+    alive = true;
+    work.emplace(ioc.get_executor());
+    ioc.restart(); // the handshake ran it to completion
+    net::post(ioc, [this]() {
+        Read();
+        Flush();
+    });
+    io = thread([this]() { ioc.run(); });
+    return true;
+}
+
+void Http2Session::Get(const shared_ptr<Http2Stream> & s, chrono::steady_clock::duration timeout)
+{
+    auto done = s->done.get_future();
+    net::post(ioc, [this, s]() {
+        if (closed) {
+            s->lost = true;
+            s->done.set_value();
+            return;
+        }
+        auto header = [](const char * name, const string & value) {
+            return nghttp2_nv { (uint8_t *)name, (uint8_t *)value.data(), strlen(name), value.size(), NGHTTP2_NV_FLAG_NONE };
+        };
+        static const string GET = "GET", HTTPS = "https", USER_AGENT = "cpp-eansearch/1.0";
+        nghttp2_nv headers[] = {
+            header(":method", GET),
+            header(":scheme", HTTPS),
+            header(":authority", authority),
+            header(":path", s->path),
+            header("user-agent", USER_AGENT),
+            header("accept-encoding", accept_encoding)
+        };
+        size_t count = sizeof(headers) / sizeof(headers[0]) - (accept_encoding.empty() ? 1 : 0);
+        s->id = nghttp2_submit_request(session, nullptr, headers, count, nullptr, s.get());
+        if (s->id < 0) {
+            // out of stream ids, the next request opens a new connection
+            alive = false;
+            s->lost = true;
+            s->done.set_value();
+            return;
+        }
+        open[s.get()] = s;
+        Flush();
+    });
+    if (timeout.count() <= 0 || done.wait_for(timeout) == future_status::ready) {
+        done.wait();
+        return;
+    }
+    {
+        lock_guard<mutex> guard(s->lock);
+        s->timer = nullptr;
+    }
+    net::post(ioc, [this, s]() {
+        if (!closed && open.count(s.get())) {
+            nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, s->id, NGHTTP2_CANCEL);
+            Flush();
+        }
+    });
+    throw boost::system::system_error{beast::error::timeout};
+}
+
+Http2Stream * Http2Session::StreamOf(int32_t stream_id)
+{
+    return static_cast<Http2Stream *>(nghttp2_session_get_stream_user_data(session, stream_id));
+}
+
+int Http2Session::OnBeginHeaders(nghttp2_session *, const nghttp2_frame * frame, void * user_data)
+{
+    auto self = static_cast<Http2Session *>(user_data);
+    if (frame->hd.type == NGHTTP2_HEADERS && frame->headers.cat == NGHTTP2_HCAT_RESPONSE) {
+        if (Http2Stream * s = self->StreamOf(frame->hd.stream_id)) {
+            WithTimer(s, [](RequestTimer & timer) { timer.Mark(PhaseFirstByte); });
+        }
+    }
+    return 0;
+}
+
+int Http2Session::OnHeader(nghttp2_session *, const nghttp2_frame * frame, const uint8_t * name, size_t namelen,
+                           const uint8_t * value, size_t valuelen, uint8_t, void * user_data)
+{
+    auto self = static_cast<Http2Session *>(user_data);
+    Http2Stream * s = frame->hd.type == NGHTTP2_HEADERS ? self->StreamOf(frame->hd.stream_id) : nullptr;
+    if (!s) {
+        return 0;
+    }
+    string_view n((const char *)name, namelen);
+    string_view v((const char *)value, valuelen);
+    // HTTP/2 header names are lower case
+    if (n == ":status") {
+        s->status = atoi(string(v).c_str());
+    } else if (n == "x-credits-remaining") {
+        s->credits.assign(v);
+    } else if (n == "content-encoding") {
+        s->encoding.assign(v);
+    }
+    WithTimer(s, [&](RequestTimer & timer) { timer.Add(ClientMetrics::BytesReceived, namelen + valuelen); });
+    return 0;
+}
+
+int Http2Session::OnData(nghttp2_session *, uint8_t, int32_t stream_id, const uint8_t * data, size_t len, void * user_data)
+{
+    auto self = static_cast<Http2Session *>(user_data);
+    if (Http2Stream * s = self->StreamOf(stream_id)) {
+        s->body.append((const char *)data, len);
+        WithTimer(s, [&](RequestTimer & timer) { timer.Add(ClientMetrics::BytesReceived, len); });
+    }
+    return 0;
+}
+
+int Http2Session::OnFrameSend(nghttp2_session *, const nghttp2_frame * frame, void * user_data)
+{
+    auto self = static_cast<Http2Session *>(user_data);
+    if (frame->hd.type == NGHTTP2_HEADERS) {
+        if (Http2Stream * s = self->StreamOf(frame->hd.stream_id)) {
+            WithTimer(s, [&](RequestTimer & timer) {
+                timer.Add(ClientMetrics::BytesSent, frame->hd.length);
+                timer.Mark(PhaseWrite);
+            });
+        }
+    }
+    return 0;
+}
+
+int Http2Session::OnFrameRecv(nghttp2_session *, const nghttp2_frame * frame, void * user_data)
+{
+    auto self = static_cast<Http2Session *>(user_data);
+    if (frame->hd.type == NGHTTP2_GOAWAY) {
+        // streams above the last id are refused and closed by nghttp2, new requests go elsewhere
+        self->alive = false;
+    } else if (frame->hd.type == NGHTTP2_DATA && (frame->hd.flags & NGHTTP2_FLAG_END_STREAM)) {
+        if (Http2Stream * s = self->StreamOf(frame->hd.stream_id)) {
+            WithTimer(s, [](RequestTimer & timer) { timer.Mark(PhaseRead); });
+        }
+    }
+    return 0;
+}
+
+int Http2Session::OnStreamClose(nghttp2_session *, int32_t stream_id, uint32_t error_code, void * user_data)
+{
+    auto self = static_cast<Http2Session *>(user_data);
+    if (Http2Stream * s = self->StreamOf(stream_id)) {
+        s->error = error_code;
+        s->lost = error_code == NGHTTP2_REFUSED_STREAM;
+        s->done.set_value();
+        self->open.erase(s); // may free the stream if its caller gave up
+    }
+    return 0;
+}
+
+void Http2Session::Read()
+{
+    stream.async_read_some(net::buffer(input), [this](beast::error_code ec, size_t n) {
+        if (ec || closed) {
+            Fail();
+            return;
+        }
+        if (nghttp2_session_mem_recv(session, (const uint8_t *)input.data(), n) < 0) {
+            Fail();
+            return;
+        }
+        Flush();
+        if (!closed) {
+            Read();
+        }
+    });
+}
+
+void Http2Session::Flush()
+{
+    if (writing || closed) {
+        return;
+    }
+    output.clear();
+    for (;;) {
+        const uint8_t * data;
+        ssize_t n = nghttp2_session_mem_send(session, &data);
+        if (n < 0) {
+            Fail();
+            return;
+        }
+        if (n == 0) {
+            break;
+        }
+        output.append((const char *)data, n);
+    }
+    if (output.empty()) {
+        if (!nghttp2_session_want_read(session) && !nghttp2_session_want_write(session)) {
+            Fail(); // after GOAWAY, once all streams are closed
+        }
+        return;
+    }
+    writing = true;
+    net::async_write(stream, net::buffer(output), [this](beast::error_code ec, size_t) {
+        writing = false;
+        if (ec) {
+            Fail();
+            return;
+        }
+        Flush();
+    });
+}
+
+void Http2Session::Fail()
+{
+    alive = false;
+    if (closed) {
+        return;
+    }
+    closed = true;
+    beast::error_code ec;
+    beast::get_lowest_layer(stream).socket().close(ec);
+    for (auto & s : open) {
+        s.second->lost = true;
+        s.second->done.set_value();
+    }
+    open.clear();
+}
+
+Http2Client::Http2Client(int connections) : ctx(ssl::context::tlsv12_client) {
+    this->sessions.resize(max(connections, 1));
+    this->next = 0;
+    this->opened = 0;
+    this->reused = 0;
+}
+
+Http2Client::~Http2Client() {
+}
+
+shared_ptr<Http2Session> Http2Client::Session(const string & host, const string & port, const Http2Timeouts & timeouts,
+                                              RequestTimer & timer, bool & existing)
+{
+    size_t slot = next++ % sessions.size();
+    {
+        lock_guard<mutex> guard(lock);
+        if (!http1_only.empty() && http1_only.count({ host, port })) {
+            return nullptr;
+        }
+        auto & s = sessions[slot];
+        if (s && s->Alive() && s->host == host && s->port == port) {
+            existing = true;
+            reused++;
+            return s;
+        }
+    }
+    // connect outside the lock, requests on the other connections go on meanwhile
+    auto s = make_shared<Http2Session>(ctx, host, port);
+    if (!s->Connect(resolver, timeouts, timer)) {
+        lock_guard<mutex> guard(lock);
+        http1_only.insert({ host, port });
+        return nullptr;
+    }
+    opened++;
+    lock_guard<mutex> guard(lock);
+    sessions[slot] = s;
+    return s;
+}
+
+bool Http2Client::Get(const string & host, const string & port, const string & target, Http2Response & res,
+                      const Http2Timeouts & timeouts, RequestTimer & timer)
+{
+    thread_local Decompressor decompressor;
+    thread_local string encoded;
+    for (int attempt = 1; ; attempt++) {
+        bool existing = false;
+        auto session = Session(host, port, timeouts, timer, existing);
+        if (!session) {
+            return false;
+        }
+        auto s = make_shared<Http2Stream>();
+        s->path = target;
+        s->timer = &timer;
+        s->body.swap(res.body); // reuse its capacity
+        s->body.clear();
+        session->Get(s, timeouts.stream);
+        res.body.swap(s->body);
+        if (s->lost && existing && attempt == 1) {
+            // the connection failed or the server refused the stream, try once more
+            continue;
+        }
+        if (s->lost) {
+            throw runtime_error("HTTP/2 connection lost");
+        }
+        if (s->error) {
+            throw runtime_error(string("HTTP/2 stream reset: ") + nghttp2_http2_strerror(s->error));
+        }
+        res.status = s->status;
+        res.credits.swap(s->credits);
+        if (!s->encoding.empty()) {
+            // both buffers keep their capacity for the next response
+            encoded.swap(res.body);
+            if (!decompressor.Decompress(s->encoding, encoded, res.body)) {
+                throw runtime_error("Can't decode response with Content-Encoding " + s->encoding);
+            }
+        }
+        return true;
+    }
+}
+
+PoolStats Http2Client::Stats() const
+{
+    lock_guard<mutex> guard(lock);
+    int64_t alive = 0;
+    for (auto & s : sessions) {
+        if (s && s->Alive()) {
+            alive++;
+        }
+    }
+    return PoolStats { alive, 0, opened.load(), reused.load() };
+}
+
+#endif // EANSEARCH_HTTP2
@@ -0,0 +1,126 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_HTTP2_HPP
+#define EANSEARCH_HTTP2_HPP
+
+#ifdef EANSEARCH_HTTP2
+
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <boost/asio/ssl.hpp>
+#include "eansearch_metrics.hpp"
+#include "eansearch_pool.hpp"
+using namespace std;
+
+
+/// Concurrent streams we accept per connection; the server may allow fewer
+const int HTTP2_MAX_STREAMS = 256;
+/// Flow control window of each stream
+const int HTTP2_STREAM_WINDOW = 1 << 20;
+/// Flow control window of each connection, shared by its streams
+const int HTTP2_CONNECTION_WINDOW = 16 << 20;
+
+class Http2Session;
+
+/**
+ * @brief Time limits of Http2Client::Get(), zero for no limit.
+ */
+struct Http2Timeouts {
+    /// Connecting and handshaking, only if a new connection is needed
+    chrono::steady_clock::duration connect;
+    chrono::steady_clock::duration handshake;
+    /// From sending the request to the end of the response
+    chrono::steady_clock::duration stream;
+};
+
+/**
+ * @brief Response to a request sent with Http2Client::Get().
+ */
+struct Http2Response {
+    int status;
+    /// Value of the X-Credits-Remaining header, empty if there was none
+    string credits;
+    /// Body, decoded if the server compressed it
+    string body;
+};
+
+/**
+ * @brief HTTP/2 connections to the API server, shared by all threads of a client.
+ *
+ * Requests of all threads are multiplexed as streams over a few TLS
+ * connections, so thousands of concurrent requests need a handful of
+ * sockets instead of one connection each. Each connection has an I/O
+ * thread that runs the nghttp2 session; callers block until their
+ * stream is closed. nghttp2 queues requests beyond the server's stream
+ * limit and sends the WINDOW_UPDATE frames for flow control.
+ *
+ * Servers that don't negotiate "h2" with ALPN are remembered, and Get()
+ * returns false for them so the caller can use HTTP/1.1 instead.
+ *
+ * Only built with EANSEARCH_HTTP2 (link with -lnghttp2).
+ */
+class Http2Client
+{
+public:
+    /**
+     * @param connections Connections per server, requests are spread round-robin.
+     */
+    Http2Client(int connections = 1);
+    ~Http2Client();
+
+    /**
+     * @brief Send a GET request and wait for the response.
+     * @param host Server host name.
+     * @param port Server port.
+     * @param target Path and query of the request.
+     * @param res Receives the response; the capacity of res.body is reused.
+     * @param timeouts Limits of the request; the stream is reset if it runs out of time.
+     * @param timer Records the phases of the request.
+     * @return false if the server doesn't support HTTP/2; throws on network and protocol errors.
+     *
+     * A request that fails on an existing connection is sent once more on a new one.
+     */
+    bool Get(const string & host, const string & port, const string & target, Http2Response & res,
+             const Http2Timeouts & timeouts, RequestTimer & timer);
+
+    /**
+     * @brief Open connections as busy, the opened connections and the requests sent on an existing one.
+     */
+    PoolStats Stats() const;
+
+    /// Addresses of the servers, shared by all connections
+    ResolverCache resolver;
+
+private:
+    Http2Client(const Http2Client &) = delete;
+    Http2Client & operator=(const Http2Client &) = delete;
+
+    /// Connection for the next request, nullptr if the server only speaks HTTP/1.1
+    shared_ptr<Http2Session> Session(const string & host, const string & port, const Http2Timeouts & timeouts,
+                                     RequestTimer & timer, bool & existing);
+
+    ssl::context ctx;
+    mutable mutex lock;
+    vector<shared_ptr<Http2Session>> sessions;
+    /// Servers without HTTP/2 support
+    set<pair<string, string>> http1_only;
+    atomic<uint64_t> next;
+    atomic<uint64_t> opened;
+    atomic<uint64_t> reused;
+};
+
+#endif // EANSEARCH_HTTP2
+
+#endif // EANSEARCH_HTTP2_HPP
@@ -0,0 +1,159 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_metrics.hpp"
+
+using namespace std;
+
+int HistogramSnapshot::BucketOf(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return value;
+    }
+    int exp = 63 - __builtin_clzll(value); // >= 4
+    int bucket = (exp - 3) * HISTOGRAM_SUB_BUCKETS + (int)(value >> (exp - 4)) - HISTOGRAM_SUB_BUCKETS;
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+uint64_t HistogramSnapshot::BucketStart(int bucket)
+{
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+    int exp = bucket / HISTOGRAM_SUB_BUCKETS + 3;
+    return (uint64_t)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << (exp - 4);
+}
+
+uint64_t HistogramSnapshot::Percentile(double p) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p / 100.0 * count + 0.5);
+    rank = rank < 1 ? 1 : (rank > count ? count : rank);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+            // middle of the bucket, but never above the largest value seen
+            uint64_t start = BucketStart(b);
+            uint64_t end = b + 1 < (size_t)HISTOGRAM_BUCKETS ? BucketStart(b + 1) : start + 1;
+            uint64_t mid = start + (end - start) / 2;
+            return mid < max ? mid : max;
+        }
+    }
+    return max;
+}
+
+int ClientMetrics::OpIndex(string_view op)
+{
+    for (int i = 0; i < METRICS_OP_COUNT - 1; i++) {
+        if (op == METRICS_OPS[i]) {
+            return i;
+        }
+    }
+    return METRICS_OP_COUNT - 1;
+}
+
+#ifndef EANSEARCH_NO_METRICS
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto & c : counts) {
+        c.store(0, memory_order_relaxed);
+    }
+    count.store(0, memory_order_relaxed);
+    sum.store(0, memory_order_relaxed);
+    max.store(0, memory_order_relaxed);
+}
+
+void LatencyHistogram::Record(uint64_t micros)
+{
+    counts[HistogramSnapshot::BucketOf(micros)].fetch_add(1, memory_order_relaxed);
+    count.fetch_add(1, memory_order_relaxed);
+    sum.fetch_add(micros, memory_order_relaxed);
+    uint64_t m = max.load(memory_order_relaxed);
+    while (micros > m && !max.compare_exchange_weak(m, micros, memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const
+{
+    HistogramSnapshot s;
+    s.counts.resize(HISTOGRAM_BUCKETS);
+    s.count = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        s.counts[b] = counts[b].load(memory_order_relaxed);
+        s.count += s.counts[b]; // consistent with the buckets even while recording
+    }
+    s.sum = sum.load(memory_order_relaxed);
+    s.max = max.load(memory_order_relaxed);
+    return s;
+}
+
+ClientMetrics::ClientMetrics() {
+    for (auto & op : counters) {
+        for (auto & c : op) {
+            c.store(0, memory_order_relaxed);
+        }
+    }
+    in_flight.store(0, memory_order_relaxed);
+}
+
+void ClientMetrics::Add(int op, Counter counter, uint64_t value)
+{
+    counters[op][counter].fetch_add(value, memory_order_relaxed);
+}
+
+void ClientMetrics::RecordPhase(int op, Phase phase, uint64_t micros)
+{
+    histograms[op][phase].Record(micros);
+}
+
+void ClientMetrics::RecordRateLimitWait(uint64_t micros)
+{
+    rate_limit_wait.Record(micros);
+}
+
+void ClientMetrics::AddInFlight(int64_t delta)
+{
+    in_flight.fetch_add(delta, memory_order_relaxed);
+}
+
+MetricsSnapshot ClientMetrics::Snapshot() const
+{
+    MetricsSnapshot snapshot;
+    snapshot.in_flight = in_flight.load(memory_order_relaxed);
+    snapshot.rate_limit_wait = rate_limit_wait.Snapshot();
+    for (int i = 0; i < METRICS_OP_COUNT; i++) {
+        OpMetrics m;
+        m.op = METRICS_OPS[i];
+        m.requests = counters[i][Requests].load(memory_order_relaxed);
+        m.errors = counters[i][Errors].load(memory_order_relaxed);
+        m.timed_out = counters[i][TimedOut].load(memory_order_relaxed);
+        m.retries = counters[i][Retries].load(memory_order_relaxed);
+        m.hedges = counters[i][Hedges].load(memory_order_relaxed);
+        m.hedge_wins = counters[i][HedgeWins].load(memory_order_relaxed);
+        m.rejected = counters[i][Rejected].load(memory_order_relaxed);
+        m.status_2xx = counters[i][Status2xx].load(memory_order_relaxed);
+        m.status_4xx = counters[i][Status4xx].load(memory_order_relaxed);
+        m.status_5xx = counters[i][Status5xx].load(memory_order_relaxed);
+        m.throttled = counters[i][Throttled].load(memory_order_relaxed);
+        m.cache_hits = counters[i][CacheHits].load(memory_order_relaxed);
+        m.cache_misses = counters[i][CacheMisses].load(memory_order_relaxed);
+        m.bytes_sent = counters[i][BytesSent].load(memory_order_relaxed);
+        m.bytes_received = counters[i][BytesReceived].load(memory_order_relaxed);
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            m.phases[p] = histograms[i][p].Snapshot();
+        }
+        snapshot.ops.push_back(m);
+    }
+    return snapshot;
+}
+
+#endif // EANSEARCH_NO_METRICS
@@ -0,0 +1,277 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_METRICS_HPP
+#define EANSEARCH_METRICS_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+using namespace std;
+
+
+/**
+ * @brief Phases of an API request, timed separately.
+ */
+enum Phase {
+    PhaseResolve,
+    PhaseConnect,
+    PhaseHandshake,
+    PhaseWrite,
+    PhaseFirstByte,
+    PhaseRead,
+    PhaseParse,
+    PhaseTotal,
+    PHASE_COUNT
+};
+
+/// API operations with their own metrics; all others count as "other"
+const char * const METRICS_OPS[] = {
+    "barcode-lookup", "verify-checksum", "product-search", "similar-product-search",
+    "category-search", "barcode-prefix-search", "issuing-country", "barcode-image",
+    "account-status", "other"
+};
+const int METRICS_OP_COUNT = sizeof(METRICS_OPS) / sizeof(METRICS_OPS[0]);
+
+/// Histogram buckets: 16 linear sub-buckets per power of two, up to 2^34 microseconds
+const int HISTOGRAM_SUB_BUCKETS = 16;
+const int HISTOGRAM_BUCKETS = (34 - 3 + 1) * HISTOGRAM_SUB_BUCKETS;
+
+/**
+ * @brief Copy of a latency histogram; values are in microseconds.
+ */
+struct HistogramSnapshot {
+    vector<uint64_t> counts;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+    /**
+     * @brief Estimate a percentile.
+     * @param p Percentile, 0..100.
+     * @return Latency in microseconds (within about 6%), 0 if empty.
+     */
+    uint64_t Percentile(double p) const;
+
+    /**
+     * @brief Lowest value counted in a bucket.
+     */
+    static uint64_t BucketStart(int bucket);
+
+    /**
+     * @brief Bucket a value is counted in.
+     */
+    static int BucketOf(uint64_t value);
+};
+
+/**
+ * @brief Metrics of one API operation.
+ */
+struct OpMetrics {
+    string op;
+    uint64_t requests;
+    /// Requests that failed without a response (network, TLS or parse errors)
+    uint64_t errors;
+    /// Requests that failed because a timeout expired, included in errors
+    uint64_t timed_out;
+    uint64_t retries;
+    /// Second requests sent for slow calls, included in requests, and calls they answered first
+    uint64_t hedges;
+    uint64_t hedge_wins;
+    /// Calls failed fast by the circuit breaker or a concurrency limit, not included in requests
+    uint64_t rejected;
+    /// Responses by status class
+    uint64_t status_2xx;
+    uint64_t status_4xx;
+    uint64_t status_5xx;
+    /// Responses with status 429 (too many requests), not included in status_4xx
+    uint64_t throttled;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    HistogramSnapshot phases[PHASE_COUNT];
+};
+
+/**
+ * @brief Metrics of a client, see EANSearch::GetMetrics().
+ */
+struct MetricsSnapshot {
+    /// One entry per operation in METRICS_OPS
+    vector<OpMetrics> ops;
+    /// Requests currently being sent or waiting for a response
+    int64_t in_flight { 0 };
+    /// Time requests waited for the rate limiter and the limit of requests in flight
+    HistogramSnapshot rate_limit_wait;
+    /// Last X-Credits-Remaining value, -1 if unknown
+    int credits_remaining { -1 };
+    /// Credits used per hour by all clients sharing the token, -1 without a credit budget
+    double credits_burn_rate { -1 };
+    /// Credits that will be used until the end of the month at that rate, -1 without a credit budget
+    double credits_projected { -1 };
+    /// Credits used by this client per caller tag, empty without a credit budget
+    map<string, int64_t> credits_by_tag;
+    /// Connections to the API server in use by a request, and kept alive for reuse
+    int64_t connections_busy { 0 };
+    int64_t connections_idle { 0 };
+    /// Connections opened, and requests sent on a kept-alive connection
+    uint64_t connections_opened { 0 };
+    uint64_t connections_reused { 0 };
+    /// State of the circuit breaker: 0 closed (or no breaker), 1 open, 2 half-open
+    int circuit_state { 0 };
+    /// Requests waiting to be sent, by Priority (interactive, normal, batch)
+    vector<int64_t> queue_depth;
+};
+
+#ifndef EANSEARCH_NO_METRICS
+
+/**
+ * @brief Lock-free latency histogram with logarithmic buckets (HDR style).
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+    void Record(uint64_t micros);
+    HistogramSnapshot Snapshot() const;
+
+private:
+    atomic<uint64_t> counts[HISTOGRAM_BUCKETS];
+    atomic<uint64_t> count;
+    atomic<uint64_t> sum;
+    atomic<uint64_t> max;
+};
+
+/**
+ * @brief Counters and phase histograms of all API operations.
+ *
+ * All methods are thread-safe and use relaxed atomic updates only.
+ */
+class ClientMetrics
+{
+public:
+    enum Counter {
+        Requests,
+        Errors,
+        TimedOut,
+        Retries,
+        Hedges,
+        HedgeWins,
+        Rejected,
+        Status2xx,
+        Status4xx,
+        Status5xx,
+        Throttled,
+        CacheHits,
+        CacheMisses,
+        BytesSent,
+        BytesReceived,
+        COUNTER_COUNT
+    };
+
+    ClientMetrics();
+
+    /**
+     * @brief Index of an operation name in METRICS_OPS.
+     */
+    static int OpIndex(string_view op);
+
+    void Add(int op, Counter counter, uint64_t value = 1);
+    void RecordPhase(int op, Phase phase, uint64_t micros);
+    void RecordRateLimitWait(uint64_t micros);
+    void AddInFlight(int64_t delta);
+    MetricsSnapshot Snapshot() const;
+
+private:
+    atomic<uint64_t> counters[METRICS_OP_COUNT][COUNTER_COUNT];
+    atomic<int64_t> in_flight;
+    LatencyHistogram rate_limit_wait;
+    LatencyHistogram histograms[METRICS_OP_COUNT][PHASE_COUNT];
+};
+
+/**
+ * @brief Times the phases of one request.
+ *
+ * Each call to Mark() records the time since the previous call
+ * (or since construction) for the given phase.
+ */
+class RequestTimer
+{
+public:
+    RequestTimer(ClientMetrics & metrics, string_view op)
+        : metrics(metrics), op(ClientMetrics::OpIndex(op)),
+          start(chrono::steady_clock::now()), last(start) { }
+
+    void Mark(Phase phase) {
+        auto now = chrono::steady_clock::now();
+        metrics.RecordPhase(op, phase, chrono::duration_cast<chrono::microseconds>(now - last).count());
+        last = now;
+    }
+
+    /// Start timing again from now
+    void Restart() {
+        start = last = chrono::steady_clock::now();
+    }
+
+    /// Record the time since construction as the total
+    void Total() {
+        auto now = chrono::steady_clock::now();
+        metrics.RecordPhase(op, PhaseTotal, chrono::duration_cast<chrono::microseconds>(now - start).count());
+    }
+
+    void Add(ClientMetrics::Counter counter, uint64_t value = 1) {
+        metrics.Add(op, counter, value);
+    }
+
+    /// Count a response by its status code
+    void Status(int status) {
+        metrics.Add(op, status == 429 ? ClientMetrics::Throttled
+                        : status >= 500 ? ClientMetrics::Status5xx
+                        : status >= 400 ? ClientMetrics::Status4xx : ClientMetrics::Status2xx);
+    }
+
+private:
+    ClientMetrics & metrics;
+    int op;
+    chrono::steady_clock::time_point start;
+    chrono::steady_clock::time_point last;
+};
+
+#else // EANSEARCH_NO_METRICS
+
+/// Metrics compiled out: everything below does nothing
+class ClientMetrics
+{
+public:
+    enum Counter { Requests, Errors, TimedOut, Retries, Hedges, HedgeWins, Rejected, Status2xx, Status4xx, Status5xx, Throttled,
+                   CacheHits, CacheMisses, BytesSent, BytesReceived };
+    static int OpIndex(string_view op);
+    void RecordRateLimitWait(uint64_t) { }
+    void AddInFlight(int64_t) { }
+    MetricsSnapshot Snapshot() const { return MetricsSnapshot{}; }
+};
+
+class RequestTimer
+{
+public:
+    RequestTimer(ClientMetrics &, string_view) { }
+    void Mark(Phase) { }
+    void Restart() { }
+    void Total() { }
+    void Add(ClientMetrics::Counter, uint64_t = 1) { }
+    void Status(int) { }
+};
+
+#endif // EANSEARCH_NO_METRICS
+
+#endif // EANSEARCH_METRICS_HPP
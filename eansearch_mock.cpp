@@ -0,0 +1,578 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_mock.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/x509v3.h>
+#include <zlib.h>
+#ifdef EANSEARCH_HTTP2
+#include <map>
+#include <memory>
+#include <nghttp2/nghttp2.h>
+#endif
+
+using namespace std;
+
+namespace beast = boost::beast; // from <boost/beast.hpp>
+namespace http = beast::http;   // from <boost/beast/http.hpp>
+namespace net = boost::asio;    // from <boost/asio.hpp>
+namespace ssl = net::ssl;       // from <boost/asio/ssl.hpp>
+using tcp = net::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
+
+/// Product names for canned results, with some non-ASCII characters
+static const char * const MOCK_NAMES[] = {
+    "Bananaboat Sonnenschutz LSF 50 200 ml",
+    "Crème brûlée Dessert 4 x 100 g",
+    "Großer Gartenschlauch grün 25 m",
+    "Ёлочная гирлянда 100 LED",
+    "抹茶 Matcha Tee Bio 30 g",
+    "Apple iPhone 15 Pro Max 256GB Titan",
+    "LEGO Technic 42151 Bugatti Bolide",
+    "Café Royal Espresso Kapseln 36 Stück"
+};
+const int MOCK_NAME_COUNT = sizeof(MOCK_NAMES) / sizeof(MOCK_NAMES[0]);
+
+struct MockServerState {
+    net::io_context ioc;
+    tcp::acceptor acceptor { ioc };
+    ssl::context ctx { ssl::context::tlsv12_server };
+    atomic<int> latency { 0 };
+    atomic<double> tail_share { 0 };
+    atomic<int> tail_latency { 0 };
+    atomic<uint64_t> delayed { 0 };
+    atomic<double> throttle { 0 };
+    atomic<int> page_size { 10 };
+    atomic<bool> gzip { false };
+    atomic<bool> http2 { false };
+    atomic<int> max_requests { 0 };
+    atomic<uint64_t> requests { 0 };
+    atomic<int64_t> credits { 1000000 };
+    atomic<uint64_t> credits_used { 0 };
+};
+
+/**
+ * @brief Install a new self-signed certificate for "localhost" in an SSL context.
+ */
+static bool SelfSignedCertificate(SSL_CTX * ctx) {
+    EVP_PKEY * key = nullptr;
+    EVP_PKEY_CTX * kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    if (!kctx || EVP_PKEY_keygen_init(kctx) <= 0
+        || EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1) <= 0
+        || EVP_PKEY_keygen(kctx, &key) <= 0) {
+        EVP_PKEY_CTX_free(kctx);
+        return false;
+    }
+    EVP_PKEY_CTX_free(kctx);
+
+    X509 * cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 7 * 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME * name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509V3_CTX v3;
+    X509V3_set_ctx(&v3, cert, cert, nullptr, nullptr, 0);
+    X509_EXTENSION * san = X509V3_EXT_conf_nid(nullptr, &v3, NID_subject_alt_name, "DNS:localhost,IP:127.0.0.1");
+    if (san) {
+        X509_add_ext(cert, san, -1);
+        X509_EXTENSION_free(san);
+    }
+    bool ok = X509_sign(cert, key, EVP_sha256()) > 0
+        && SSL_CTX_use_certificate(ctx, cert) == 1
+        && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+/**
+ * @brief Value of a query parameter, def if missing.
+ */
+static string Param(const string & params, const string & name, const string & def = "") {
+    size_t start = 0;
+    while (start < params.size()) {
+        size_t end = params.find('&', start);
+        if (end == string::npos) {
+            end = params.size();
+        }
+        if (params.compare(start, name.size() + 1, name + "=") == 0) {
+            return params.substr(start + name.size() + 1, end - start - name.size() - 1);
+        }
+        start = end + 1;
+    }
+    return def;
+}
+
+static void ProductJSON(string & out, const string & ean, int n, bool full) {
+    out += "{\"ean\":\"" + ean + "\",\"name\":\"" + MOCK_NAMES[n % MOCK_NAME_COUNT]
+        + "\",\"categoryId\":\"" + to_string(40 + n % 8) + "\",\"categoryName\":\"Category " + to_string(40 + n % 8)
+        + "\",\"issuingCountry\":\"DE\"";
+    if (full) {
+        out += ",\"googleCategoryId\":\"" + to_string(500 + n % 8) + "\"";
+    }
+    out += "}";
+}
+
+string MockAPIServer::Response(const string & params, int page_size)
+{
+    string op = Param(params, "op");
+    string ean = Param(params, "ean", Param(params, "isbn", "4007249000011"));
+    string body;
+    if (op == "barcode-lookup") {
+        body = "[";
+        ProductJSON(body, ean, ean.back(), true);
+        body += "]";
+    } else if (op == "verify-checksum") {
+        body = "[{\"ean\":\"" + ean + "\",\"valid\":\"1\"}]";
+    } else if (op == "issuing-country") {
+        body = "[{\"ean\":\"" + ean + "\",\"issuingCountry\":\"DE\"}]";
+    } else if (op == "barcode-image") {
+        // a 1x1 PNG stands in for the barcode
+        body = "[{\"ean\":\"" + ean + "\",\"barcode\":\"iVBORw0KGgoAAAANSUhEUgAAAAEAAAABCAYAAAAfFcSJAAAADUlEQVR42mNk"
+            "YPhfDwAChwGA60e6kgAAAABJRU5ErkJggg==\"}]";
+    } else if (op == "account-status") {
+        body = "{\"id\":\"1\",\"name\":\"mock\",\"email\":\"mock@localhost\",\"api-requests\":\"0\",\"api-credits\":\"1000000\"}";
+    } else if (op == "product-search" || op == "similar-product-search" || op == "category-search"
+               || op == "barcode-prefix-search") {
+        int page = atoi(Param(params, "page", "0").c_str());
+        string prefix = Param(params, "prefix", "4007249");
+        body = "{\"page\":" + to_string(page) + ",\"moreproducts\":true,\"totalproducts\":1000,\"productlist\":[";
+        for (int i = 0; i < page_size; i++) {
+            string code = to_string(page * page_size + i);
+            code = prefix + string(prefix.size() + code.size() < 13 ? 13 - prefix.size() - code.size() : 0, '0') + code;
+            if (i > 0) {
+                body += ",";
+            }
+            ProductJSON(body, code.substr(0, 13), i, false);
+        }
+        body += "]}";
+    } else {
+        body = "{\"error\":\"Invalid operation\"}";
+    }
+    return body;
+}
+
+/**
+ * @brief Compress a response body in gzip format.
+ */
+static string Gzip(const string & body) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    string out(deflateBound(&zs, body.size()) + 32, '\0');
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(body.data()));
+    zs.avail_in = body.size();
+    zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+    zs.avail_out = out.size();
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+/**
+ * @brief Response to one request.
+ */
+struct MockResponse {
+    int status;
+    string credits;
+    string body;
+    bool gzip;
+};
+
+/**
+ * @brief Wait before a response: the latency, and the tail latency for a share of the responses.
+ */
+static void Delay(MockServerState & state) {
+    int micros = state.latency.load();
+    // deterministic like throttling, every 1/share-th response is slow
+    double share = state.tail_share.load();
+    uint64_t n = state.delayed.fetch_add(1);
+    if ((uint64_t)((n + 1) * share) > (uint64_t)(n * share)) {
+        micros += state.tail_latency.load();
+    }
+    if (micros) {
+        this_thread::sleep_for(chrono::microseconds(micros));
+    }
+}
+
+/**
+ * @brief Answer a request for target, without the delay.
+ */
+static MockResponse Answer(MockServerState & state, const string & target, beast::string_view accept_encoding) {
+    uint64_t n = state.requests.fetch_add(1);
+    // the credits start over when used up, so long benchmarks don't run out
+    int64_t credits = state.credits.load();
+    MockResponse res { 200, to_string(credits - (int64_t)(state.credits_used.fetch_add(1) % credits)), string(), false };
+    // deterministic throttling: the share of 429s is exact after every request
+    double share = state.throttle.load();
+    if ((uint64_t)((n + 1) * share) > (uint64_t)(n * share)) {
+        res.status = 429;
+        res.body = "{\"error\":\"Too many requests\"}";
+        return res;
+    }
+    auto q = target.find('?');
+    res.body = MockAPIServer::Response(q == string::npos ? "" : target.substr(q + 1), state.page_size.load());
+    if (state.gzip && accept_encoding.find("gzip") != beast::string_view::npos) {
+        res.body = Gzip(res.body);
+        res.gzip = true;
+    }
+    return res;
+}
+
+#ifdef EANSEARCH_HTTP2
+/**
+ * @brief Choose "h2" with ALPN if HTTP/2 is enabled and the client offers it, else "http/1.1".
+ */
+static int SelectProtocol(SSL *, const unsigned char ** out, unsigned char * outlen,
+                          const unsigned char * in, unsigned int inlen, void * arg) {
+    auto state = static_cast<MockServerState *>(arg);
+    const unsigned char * http11 = nullptr;
+    for (unsigned int i = 0; i < inlen; i += 1 + in[i]) {
+        string_view protocol((const char *)in + i + 1, min<unsigned int>(in[i], inlen - i - 1));
+        if (protocol == "h2" && state->http2) {
+            *out = in + i + 1;
+            *outlen = in[i];
+            return SSL_TLSEXT_ERR_OK;
+        }
+        if (protocol == "http/1.1") {
+            http11 = in + i;
+        }
+    }
+    if (http11) {
+        *out = http11 + 1;
+        *outlen = http11[0];
+        return SSL_TLSEXT_ERR_OK;
+    }
+    return SSL_TLSEXT_ERR_NOACK;
+}
+
+/**
+ * @brief A request on an HTTP/2 connection of the mock server.
+ */
+struct MockStream {
+    string path;
+    string accept_encoding;
+    MockResponse res;
+    size_t sent = 0;
+};
+
+/**
+ * @brief State of an HTTP/2 connection of the mock server, used by the nghttp2 callbacks.
+ */
+struct MockHttp2Connection {
+    map<int32_t, unique_ptr<MockStream>> streams;
+    /// Streams with a complete request, to be answered after the next read
+    vector<int32_t> complete;
+};
+
+static int OnMockBeginHeaders(nghttp2_session *, const nghttp2_frame * frame, void * user_data) {
+    if (frame->hd.type == NGHTTP2_HEADERS && frame->headers.cat == NGHTTP2_HCAT_REQUEST) {
+        static_cast<MockHttp2Connection *>(user_data)->streams[frame->hd.stream_id] = make_unique<MockStream>();
+    }
+    return 0;
+}
+
+static int OnMockHeader(nghttp2_session *, const nghttp2_frame * frame, const uint8_t * name, size_t namelen,
+                        const uint8_t * value, size_t valuelen, uint8_t, void * user_data) {
+    auto & streams = static_cast<MockHttp2Connection *>(user_data)->streams;
+    auto it = streams.find(frame->hd.stream_id);
+    if (it == streams.end()) {
+        return 0;
+    }
+    string_view n((const char *)name, namelen);
+    if (n == ":path") {
+        it->second->path.assign((const char *)value, valuelen);
+    } else if (n == "accept-encoding") {
+        it->second->accept_encoding.assign((const char *)value, valuelen);
+    }
+    return 0;
+}
+
+static int OnMockFrameRecv(nghttp2_session *, const nghttp2_frame * frame, void * user_data) {
+    auto connection = static_cast<MockHttp2Connection *>(user_data);
+    if ((frame->hd.type == NGHTTP2_HEADERS || frame->hd.type == NGHTTP2_DATA)
+        && (frame->hd.flags & NGHTTP2_FLAG_END_STREAM) && connection->streams.count(frame->hd.stream_id)) {
+        connection->complete.push_back(frame->hd.stream_id);
+    }
+    return 0;
+}
+
+static int OnMockStreamClose(nghttp2_session *, int32_t stream_id, uint32_t, void * user_data) {
+    static_cast<MockHttp2Connection *>(user_data)->streams.erase(stream_id);
+    return 0;
+}
+
+static ssize_t ReadMockBody(nghttp2_session *, int32_t, uint8_t * buf, size_t length, uint32_t * data_flags,
+                            nghttp2_data_source * source, void *) {
+    auto stream = static_cast<MockStream *>(source->ptr);
+    size_t n = min(length, stream->res.body.size() - stream->sent);
+    memcpy(buf, stream->res.body.data() + stream->sent, n);
+    stream->sent += n;
+    if (stream->sent == stream->res.body.size()) {
+        *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    }
+    return n;
+}
+
+/**
+ * @brief Serve HTTP/2 requests until the client closes the connection.
+ *
+ * The requests that have arrived are answered together after one delay,
+ * so concurrent streams don't wait for each other's latency.
+ */
+static void ServeHttp2(shared_ptr<MockServerState> state, ssl::stream<tcp::socket> & stream) {
+    MockHttp2Connection connection;
+    nghttp2_session_callbacks * callbacks;
+    nghttp2_session_callbacks_new(&callbacks);
+    nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, OnMockBeginHeaders);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, OnMockHeader);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, OnMockFrameRecv);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, OnMockStreamClose);
+    nghttp2_session * session;
+    nghttp2_session_server_new(&session, callbacks, &connection);
+    nghttp2_session_callbacks_del(callbacks);
+    nghttp2_settings_entry settings[] = { { NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, 1000 } };
+    nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, settings, 1);
+
+    beast::error_code ec;
+    char input[16384];
+    string output;
+    while (nghttp2_session_want_read(session) || nghttp2_session_want_write(session)) {
+        output.clear();
+        const uint8_t * data;
+        for (ssize_t n; (n = nghttp2_session_mem_send(session, &data)) > 0; ) {
+            output.append((const char *)data, n);
+        }
+        if (!output.empty()) {
+            net::write(stream, net::buffer(output), ec);
+            if (ec) {
+                break;
+            }
+        }
+        // take everything that has arrived, each TLS record is a read of its own
+        do {
+            size_t n = stream.read_some(net::buffer(input), ec);
+            if (ec || nghttp2_session_mem_recv(session, (const uint8_t *)input, n) < 0) {
+                ec = net::error::connection_aborted;
+                break;
+            }
+        } while (SSL_pending(stream.native_handle()) > 0 || stream.next_layer().available(ec) > 0);
+        if (ec) {
+            break;
+        }
+        if (connection.complete.empty()) {
+            continue;
+        }
+        Delay(*state);
+        for (int32_t id : connection.complete) {
+            MockStream * s = connection.streams[id].get();
+            s->res = Answer(*state, s->path, s->accept_encoding);
+            string status = to_string(s->res.status);
+            auto header = [](const char * name, const string & value) {
+                return nghttp2_nv { (uint8_t *)name, (uint8_t *)value.data(), strlen(name), value.size(), NGHTTP2_NV_FLAG_NONE };
+            };
+            static const string SERVER = "eansearch-mock", JSON = "application/json", GZIP = "gzip";
+            nghttp2_nv headers[] = {
+                header(":status", status),
+                header("server", SERVER),
+                header("content-type", JSON),
+                header("x-credits-remaining", s->res.credits),
+                header("content-encoding", GZIP)
+            };
+            nghttp2_data_provider body;
+            body.source.ptr = s;
+            body.read_callback = ReadMockBody;
+            nghttp2_submit_response(session, id, headers, s->res.gzip ? 5 : 4, &body);
+        }
+        connection.complete.clear();
+    }
+    nghttp2_session_del(session);
+}
+#endif
+
+/**
+ * @brief Serve requests on one TLS connection until the client closes it.
+ */
+static void Session(shared_ptr<MockServerState> state, tcp::socket socket) {
+    beast::error_code ec;
+    socket.set_option(tcp::no_delay(true), ec);
+    ssl::stream<tcp::socket> stream(move(socket), state->ctx);
+    stream.handshake(ssl::stream_base::server, ec);
+    if (ec) {
+        return;
+    }
+#ifdef EANSEARCH_HTTP2
+    const unsigned char * protocol = nullptr;
+    unsigned int length = 0;
+    SSL_get0_alpn_selected(stream.native_handle(), &protocol, &length);
+    if (length == 2 && memcmp(protocol, "h2", 2) == 0) {
+        ServeHttp2(state, stream);
+        stream.shutdown(ec);
+        return;
+    }
+#endif
+    beast::flat_buffer buffer;
+    for (int served = 1; ; served++) {
+        http::request<http::string_body> req;
+        http::read(stream, buffer, req, ec);
+        if (ec) {
+            break;
+        }
+        Delay(*state);
+        MockResponse answer = Answer(*state, string(req.target()), req[http::field::accept_encoding]);
+        http::response<http::string_body> res { (http::status)answer.status, req.version() };
+        res.set(http::field::server, "eansearch-mock");
+        res.set(http::field::content_type, "application/json");
+        res.set("X-Credits-Remaining", answer.credits);
+        if (answer.gzip) {
+            res.set(http::field::content_encoding, "gzip");
+        }
+        int max_requests = state->max_requests.load();
+        res.keep_alive(req.keep_alive() && (max_requests == 0 || served < max_requests));
+        res.body() = move(answer.body);
+        res.prepare_payload();
+        http::write(stream, res, ec);
+        if (ec || !res.keep_alive()) {
+            break;
+        }
+    }
+    stream.shutdown(ec);
+}
+
+static void Accept(shared_ptr<MockServerState> state) {
+    state->acceptor.async_accept([state](beast::error_code ec, tcp::socket socket) {
+        if (ec) {
+            return; // acceptor closed by Stop()
+        }
+        thread(Session, state, move(socket)).detach();
+        Accept(state);
+    });
+}
+
+MockAPIServer::MockAPIServer() {
+    this->state = make_shared<MockServerState>();
+}
+
+MockAPIServer::~MockAPIServer() {
+    Stop();
+}
+
+void MockAPIServer::SetLatency(int micros)
+{
+    state->latency = micros;
+}
+
+void MockAPIServer::SetTail(double share, int micros)
+{
+    state->tail_share = share;
+    state->tail_latency = micros;
+}
+
+void MockAPIServer::SetThrottle(double share)
+{
+    state->throttle = share;
+}
+
+void MockAPIServer::SetCompression(bool gzip)
+{
+    state->gzip = gzip;
+}
+
+bool MockAPIServer::SetHttp2(bool enable)
+{
+#ifdef EANSEARCH_HTTP2
+    state->http2 = enable;
+    return true;
+#else
+    return !enable;
+#endif
+}
+
+void MockAPIServer::SetMaxRequests(int requests)
+{
+    state->max_requests = requests;
+}
+
+void MockAPIServer::SetPageSize(int products)
+{
+    state->page_size = products;
+}
+
+void MockAPIServer::SetCredits(int64_t credits)
+{
+    state->credits = credits > 0 ? credits : 1;
+    state->credits_used = 0;
+}
+
+bool MockAPIServer::Listen(const string & address, unsigned short port)
+{
+    if (acceptor_thread.joinable()) {
+        cerr << "Error: mock server is already running" << endl;
+        return false;
+    }
+    if (!SelfSignedCertificate(state->ctx.native_handle())) {
+        cerr << "Error: can't create a certificate for the mock server" << endl;
+        return false;
+    }
+#ifdef EANSEARCH_HTTP2
+    SSL_CTX_set_alpn_select_cb(state->ctx.native_handle(), SelectProtocol, state.get());
+#endif
+    try {
+        tcp::endpoint endpoint(net::ip::make_address(address), port);
+        state->acceptor.open(endpoint.protocol());
+        state->acceptor.set_option(net::socket_base::reuse_address(true));
+        state->acceptor.bind(endpoint);
+        state->acceptor.listen(net::socket_base::max_listen_connections);
+    }
+    catch(std::exception const & e) {
+        cerr << "Error: " << e.what() << endl;
+        return false;
+    }
+    Accept(state);
+    auto s = state;
+    acceptor_thread = thread([s]() { s->ioc.run(); });
+    return true;
+}
+
+unsigned short MockAPIServer::Port() const
+{
+    beast::error_code ec;
+    return state->acceptor.local_endpoint(ec).port();
+}
+
+uint64_t MockAPIServer::Requests() const
+{
+    return state->requests.load();
+}
+
+void MockAPIServer::Stop()
+{
+    if (!acceptor_thread.joinable()) {
+        return;
+    }
+    auto s = state;
+    net::post(state->ioc, [s]() {
+        beast::error_code ec;
+        s->acceptor.close(ec);
+    });
+    acceptor_thread.join();
+}
@@ -0,0 +1,122 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_MOCK_HPP
+#define EANSEARCH_MOCK_HPP
+
+#include <string>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+using namespace std;
+
+struct MockServerState;
+
+/**
+ * @brief Local HTTPS server imitating api.ean-search.org, for benchmarks.
+ *
+ * Answers every operation with canned JSON in the format of the real API,
+ * after an optional delay, optionally gzip-compressed, and answers a share
+ * of the requests with 429 Too Many Requests. The TLS certificate is self-signed and generated
+ * in memory at startup. Point an EANSearch object at it with
+ * SetEndpoint("localhost", to_string(server.Port())).
+ *
+ * Each connection is served by its own thread and may send any number of
+ * requests (HTTP/1.1 keep-alive, or concurrent HTTP/2 streams).
+ */
+class MockAPIServer
+{
+public:
+    MockAPIServer();
+    ~MockAPIServer();
+
+    /**
+     * @brief Delay every response.
+     * @param micros Delay in microseconds (default 0).
+     */
+    void SetLatency(int micros);
+
+    /**
+     * @brief Delay a share of the responses by more, to model a latency tail.
+     * @param share 0..1 (default 0).
+     * @param micros Additional delay in microseconds.
+     */
+    void SetTail(double share, int micros);
+
+    /**
+     * @brief Answer a share of the requests with status 429.
+     * @param share 0..1 (default 0).
+     */
+    void SetThrottle(double share);
+
+    /**
+     * @brief Send bodies gzip-compressed to clients that accept it (default false).
+     */
+    void SetCompression(bool gzip);
+
+    /**
+     * @brief Serve clients that offer HTTP/2 with HTTP/2 (default false).
+     * @return false if built without EANSEARCH_HTTP2.
+     */
+    bool SetHttp2(bool enable);
+
+    /**
+     * @brief Close HTTP/1.1 connections after a number of requests, like nginx's keepalive_requests.
+     * @param requests Requests per connection, 0 for no limit (default).
+     */
+    void SetMaxRequests(int requests);
+
+    /**
+     * @brief Number of products in search results (default 10).
+     */
+    void SetPageSize(int products);
+
+    /**
+     * @brief Credits left before the next request, counted down in X-Credits-Remaining (default 1000000).
+     */
+    void SetCredits(int64_t credits);
+
+    /**
+     * @brief Start serving from a background thread.
+     * @param address Local address, e.g. "127.0.0.1".
+     * @param port TCP port, 0 for any free port.
+     * @return false if the server can't be started.
+     */
+    bool Listen(const string & address = "127.0.0.1", unsigned short port = 0);
+
+    /**
+     * @brief Port the server listens on.
+     */
+    unsigned short Port() const;
+
+    /**
+     * @brief Number of requests answered so far.
+     */
+    uint64_t Requests() const;
+
+    /**
+     * @brief Stop accepting connections; open connections are served until the client closes them.
+     */
+    void Stop();
+
+    /**
+     * @brief Canned response body of an operation.
+     * @param params Query parameters of the request, e.g. "op=barcode-lookup&ean=...".
+     * @param page_size Number of products in search results.
+     */
+    static string Response(const string & params, int page_size);
+
+private:
+    /// Shared with the connection threads, which may outlive the server object
+    shared_ptr<MockServerState> state;
+    thread acceptor_thread;
+};
+
+#endif // EANSEARCH_MOCK_HPP
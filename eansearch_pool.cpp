@@ -0,0 +1,92 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_pool.hpp"
+
+using namespace std;
+
+ConnectionPool::ConnectionPool(int max_idle) : ctx(ssl::context::tlsv12_client) {
+    this->max_idle = max_idle;
+    this->busy = 0;
+    this->opened = 0;
+    this->reused = 0;
+}
+
+ConnectionPool::~ConnectionPool() {
+    for (auto c : idle) {
+        delete c;
+    }
+}
+
+Connection * ConnectionPool::Acquire(const string & host, const string & port)
+{
+    auto oldest = chrono::steady_clock::now() - chrono::seconds(POOL_IDLE_SECONDS);
+    Connection * c = nullptr;
+    vector<Connection *> expired;
+    {
+        lock_guard<mutex> guard(lock);
+        // the oldest connections are at the front
+        while (!idle.empty() && idle.front()->last_used < oldest) {
+            expired.push_back(idle.front());
+            idle.pop_front();
+        }
+        for (auto it = idle.rbegin(); it != idle.rend(); ++it) {
+            if ((*it)->host == host && (*it)->port == port) {
+                c = *it;
+                idle.erase(next(it).base());
+                break;
+            }
+        }
+    }
+    for (auto e : expired) {
+        delete e; // outside the lock, closing may take a moment
+    }
+    if (c) {
+        busy++;
+        reused++;
+    }
+    return c;
+}
+
+Connection * ConnectionPool::Create(const string & host, const string & port)
+{
+    Connection * c = new Connection(ctx);
+    c->host = host;
+    c->port = port;
+    c->req.version(11);
+    c->req.method(http::verb::get);
+    c->req.set(http::field::host, host);
+    c->req.set(http::field::user_agent, "cpp-eansearch/1.0");
+    if (*Decompressor::AcceptEncoding()) {
+        c->req.set(http::field::accept_encoding, Decompressor::AcceptEncoding());
+    }
+    busy++;
+    opened++;
+    return c;
+}
+
+void ConnectionPool::Release(Connection * c, bool reuse)
+{
+    busy--;
+    if (reuse) {
+        c->last_used = chrono::steady_clock::now();
+        lock_guard<mutex> guard(lock);
+        if ((int)idle.size() < max_idle) {
+            idle.push_back(c);
+            return;
+        }
+    }
+    delete c;
+}
+
+PoolStats ConnectionPool::Stats() const
+{
+    lock_guard<mutex> guard(lock);
+    return PoolStats { busy.load(), (int64_t)idle.size(), opened.load(), reused.load() };
+}
@@ -0,0 +1,122 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_POOL_HPP
+#define EANSEARCH_POOL_HPP
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include "eansearch_dns.hpp"
+#include "eansearch_compress.hpp"
+using namespace std;
+
+namespace beast = boost::beast; // from <boost/beast.hpp>
+namespace http = beast::http;   // from <boost/beast/http.hpp>
+namespace net = boost::asio;    // from <boost/asio.hpp>
+namespace ssl = net::ssl;       // from <boost/asio/ssl.hpp>
+using tcp = net::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
+
+
+/// Idle connections kept per pool
+const int POOL_MAX_IDLE = 32;
+/// Idle connections older than this are closed instead of reused
+const int POOL_IDLE_SECONDS = 30;
+
+/**
+ * @brief A TLS connection to the API server with the buffers for its requests.
+ *
+ * The read buffer, the request object, the storage of the response
+ * parser and the decompression state live as long as the connection, so
+ * a request on a kept-alive connection doesn't allocate them again.
+ */
+struct Connection {
+    Connection(ssl::context & ctx) : stream(ioc, ctx), requests(0) { }
+
+    net::io_context ioc;
+    ssl::stream<beast::tcp_stream> stream;
+    beast::flat_buffer buffer;
+    http::request<http::empty_body> req;
+    /// Parsers can't be reset, a new one is constructed in place per response
+    optional<http::response_parser<http::string_body>> parser;
+    /// Decoder for compressed responses, and the buffer for the encoded body
+    Decompressor decompressor;
+    string encoded;
+    string host;
+    string port;
+    chrono::steady_clock::time_point last_used;
+    /// Requests sent on this connection
+    uint64_t requests;
+};
+
+/**
+ * @brief Counts of a connection pool, see ConnectionPool::Stats().
+ */
+struct PoolStats {
+    int64_t busy;
+    int64_t idle;
+    uint64_t opened;
+    uint64_t reused;
+};
+
+/**
+ * @brief Kept-alive connections to the API server, shared by all threads of a client.
+ *
+ * A connection is used by one request at a time: Acquire() hands out an
+ * idle connection or nullptr, Create() a new unconnected one, and Release()
+ * returns it to the pool, or closes it if it can't be reused. New
+ * connections look up the server in the pool's resolver cache.
+ */
+class ConnectionPool
+{
+public:
+    ConnectionPool(int max_idle = POOL_MAX_IDLE);
+    ~ConnectionPool();
+
+    /**
+     * @brief Take the most recently used idle connection to host:port.
+     * @return Connection, nullptr if there is none.
+     */
+    Connection * Acquire(const string & host, const string & port);
+
+    /**
+     * @brief Create a connection to host:port; the caller connects it.
+     */
+    Connection * Create(const string & host, const string & port);
+
+    /**
+     * @brief Return a connection after a request.
+     * @param c Connection from Acquire() or Create().
+     * @param reuse false to close it, e.g. after an error or "Connection: close".
+     */
+    void Release(Connection * c, bool reuse);
+
+    PoolStats Stats() const;
+
+    /// Addresses of the servers, shared by all connections of the pool
+    ResolverCache resolver;
+
+private:
+    mutable mutex lock;
+    deque<Connection *> idle;
+    ssl::context ctx;
+    int max_idle;
+    atomic<int64_t> busy;
+    atomic<uint64_t> opened;
+    atomic<uint64_t> reused;
+};
+
+#endif // EANSEARCH_POOL_HPP
@@ -0,0 +1,321 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_prometheus.hpp"
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <chrono>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+using namespace std;
+
+namespace beast = boost::beast; // from <boost/beast.hpp>
+namespace http = beast::http;   // from <boost/beast/http.hpp>
+namespace net = boost::asio;    // from <boost/asio.hpp>
+using tcp = net::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
+
+static const char * const PHASE_NAMES[PHASE_COUNT] = {
+    "resolve", "connect", "handshake", "write", "first_byte", "read", "parse", "total"
+};
+
+/// Names of the priority classes, in the order of Priority
+static const char * const PRIORITY_NAMES[PRIORITY_COUNT] = { "interactive", "normal", "batch" };
+
+/// A scrape not answered within this time is dropped, so a stalled client can't hold up the others
+static const int SCRAPE_TIMEOUT_S = 10;
+
+/// Histogram bucket bounds in microseconds
+static const uint64_t BUCKET_BOUNDS[] = {
+    500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+
+static void Header(ostringstream & out, const char * name, const char * type, const char * help) {
+    out << "# HELP eansearch_" << name << " " << help << "\n"
+        << "# TYPE eansearch_" << name << " " << type << "\n";
+}
+
+/**
+ * @brief Escape a label value: backslash, double quote and newline.
+ */
+static string LabelValue(const string & value) {
+    string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+        } else if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+/**
+ * @brief Whether any counter or histogram of an operation is non-zero.
+ *
+ * Calls can be counted without a request, e.g. rejected ones.
+ */
+static bool Used(const OpMetrics & m) {
+    const uint64_t counters[] = {
+        m.requests, m.errors, m.timed_out, m.retries, m.hedges, m.hedge_wins, m.rejected, m.status_2xx,
+        m.status_4xx, m.status_5xx, m.throttled, m.cache_hits, m.cache_misses, m.bytes_sent, m.bytes_received
+    };
+    for (uint64_t n : counters) {
+        if (n) {
+            return true;
+        }
+    }
+    for (auto & h : m.phases) {
+        if (h.count) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Write one histogram; labels are empty or end with a comma.
+ */
+static void Histogram(ostringstream & out, const char * name, const string & labels, const HistogramSnapshot & h) {
+    uint64_t cumulative = 0;
+    int b = 0;
+    for (uint64_t bound : BUCKET_BOUNDS) {
+        // buckets whose values all lie at or below the bound
+        for (; b + 1 < HISTOGRAM_BUCKETS && HistogramSnapshot::BucketStart(b + 1) <= bound + 1; b++) {
+            cumulative += h.counts[b];
+        }
+        out << "eansearch_" << name << "_bucket{" << labels << "le=\"" << bound / 1e6 << "\"} " << cumulative << "\n";
+    }
+    out << "eansearch_" << name << "_bucket{" << labels << "le=\"+Inf\"} " << h.count << "\n";
+    string plain = labels.empty() ? "" : "{" + labels.substr(0, labels.size() - 1) + "}";
+    out << "eansearch_" << name << "_sum" << plain << " " << h.sum / 1e6 << "\n";
+    out << "eansearch_" << name << "_count" << plain << " " << h.count << "\n";
+}
+
+string MetricsExporter::Render(const MetricsSnapshot & metrics)
+{
+    ostringstream out;
+    out.precision(12);
+    // skip operations that were never used, they would only add empty series
+    vector<const OpMetrics *> ops;
+    for (auto & m : metrics.ops) {
+        if (Used(m)) {
+            ops.push_back(&m);
+        }
+    }
+
+    Header(out, "requests_total", "counter", "API requests by operation and response status.");
+    for (auto m : ops) {
+        const pair<const char *, uint64_t> statuses[] = {
+            { "2xx", m->status_2xx }, { "4xx", m->status_4xx }, { "429", m->throttled },
+            { "5xx", m->status_5xx }, { "error", m->errors }
+        };
+        for (auto & s : statuses) {
+            out << "eansearch_requests_total{op=\"" << m->op << "\",status=\"" << s.first << "\"} " << s.second << "\n";
+        }
+    }
+
+    const struct {
+        const char * name;
+        const char * help;
+        uint64_t OpMetrics::*field;
+    } counters[] = {
+        { "retries_total", "Requests repeated after a 429 response or a broken connection.", &OpMetrics::retries },
+        { "hedges_total", "Second requests sent for slow calls.", &OpMetrics::hedges },
+        { "hedge_wins_total", "Calls answered by the second request first.", &OpMetrics::hedge_wins },
+        { "rejected_total", "Calls failed fast by the circuit breaker, a concurrency limit or the credit budget.", &OpMetrics::rejected },
+        { "timeouts_total", "Requests that failed because a timeout expired.", &OpMetrics::timed_out },
+        { "cache_hits_total", "Lookups answered from the cache.", &OpMetrics::cache_hits },
+        { "cache_misses_total", "Lookups not found in the cache.", &OpMetrics::cache_misses },
+        { "bytes_sent_total", "Bytes of HTTP requests sent.", &OpMetrics::bytes_sent },
+        { "bytes_received_total", "Bytes of HTTP responses received.", &OpMetrics::bytes_received }
+    };
+    for (auto & c : counters) {
+        Header(out, c.name, "counter", c.help);
+        for (auto m : ops) {
+            out << "eansearch_" << c.name << "{op=\"" << m->op << "\"} " << m->*c.field << "\n";
+        }
+    }
+
+    Header(out, "cache_hit_ratio", "gauge", "Share of lookups answered from the cache.");
+    for (auto m : ops) {
+        uint64_t lookups = m->cache_hits + m->cache_misses;
+        if (lookups) {
+            out << "eansearch_cache_hit_ratio{op=\"" << m->op << "\"} " << (double)m->cache_hits / lookups << "\n";
+        }
+    }
+
+    Header(out, "request_duration_seconds", "histogram", "Duration of API requests by phase.");
+    for (auto m : ops) {
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            if (m->phases[phase].count) {
+                Histogram(out, "request_duration_seconds",
+                    "op=\"" + m->op + "\",phase=\"" + PHASE_NAMES[phase] + "\",", m->phases[phase]);
+            }
+        }
+    }
+
+    Header(out, "in_flight_requests", "gauge", "Requests currently waiting for a response.");
+    out << "eansearch_in_flight_requests " << metrics.in_flight << "\n";
+
+    Header(out, "connections", "gauge", "Connections to the API server by state.");
+    out << "eansearch_connections{state=\"busy\"} " << metrics.connections_busy << "\n";
+    out << "eansearch_connections{state=\"idle\"} " << metrics.connections_idle << "\n";
+    Header(out, "connection_pool_utilisation", "gauge", "Share of pooled connections in use.");
+    int64_t pooled = metrics.connections_busy + metrics.connections_idle;
+    out << "eansearch_connection_pool_utilisation " << (pooled ? (double)metrics.connections_busy / pooled : 0.0) << "\n";
+    Header(out, "connections_opened_total", "counter", "Connections opened to the API server.");
+    out << "eansearch_connections_opened_total " << metrics.connections_opened << "\n";
+    Header(out, "connection_reuses_total", "counter", "Requests sent on a kept-alive connection.");
+    out << "eansearch_connection_reuses_total " << metrics.connections_reused << "\n";
+
+    Header(out, "queue_depth", "gauge", "Requests waiting for the rate limit or a free slot, by priority.");
+    for (size_t p = 0; p < metrics.queue_depth.size() && p < (size_t)PRIORITY_COUNT; p++) {
+        out << "eansearch_queue_depth{priority=\"" << PRIORITY_NAMES[p] << "\"} " << metrics.queue_depth[p] << "\n";
+    }
+
+    Header(out, "circuit_state", "gauge", "State of the circuit breaker: 0 closed, 1 open, 2 half-open.");
+    out << "eansearch_circuit_state " << metrics.circuit_state << "\n";
+
+    if (metrics.credits_remaining >= 0) {
+        Header(out, "credits_remaining", "gauge", "API credits left, as reported by the last response.");
+        out << "eansearch_credits_remaining " << metrics.credits_remaining << "\n";
+    }
+    if (metrics.credits_burn_rate >= 0) {
+        Header(out, "credits_burn_rate", "gauge", "API credits used per hour by all clients sharing the token.");
+        out << "eansearch_credits_burn_rate " << metrics.credits_burn_rate << "\n";
+        Header(out, "credits_projected", "gauge", "API credits that will be used until the end of the month at the burn rate.");
+        out << "eansearch_credits_projected " << metrics.credits_projected << "\n";
+    }
+    if (!metrics.credits_by_tag.empty()) {
+        Header(out, "credits_used_total", "counter", "API credits used by this client, by caller tag.");
+        for (auto & t : metrics.credits_by_tag) {
+            out << "eansearch_credits_used_total{tag=\"" << LabelValue(t.first) << "\"} " << t.second << "\n";
+        }
+    }
+
+    if (metrics.rate_limit_wait.count) {
+        Header(out, "rate_limit_wait_seconds", "histogram", "Time requests waited for the rate limiter and the limit of requests in flight.");
+        Histogram(out, "rate_limit_wait_seconds", "", metrics.rate_limit_wait);
+    }
+    return out.str();
+}
+
+/**
+ * @brief One scrape connection: read the request, answer it and close.
+ */
+struct Scrape : enable_shared_from_this<Scrape> {
+    beast::tcp_stream stream;
+    beast::flat_buffer buffer;
+    http::request<http::empty_body> req;
+    http::response<http::string_body> res;
+    const MetricsExporter * exporter;
+
+    Scrape(tcp::socket socket, const MetricsExporter * exporter) : stream(move(socket)) {
+        this->exporter = exporter;
+    }
+
+    void Start() {
+        stream.expires_after(chrono::seconds(SCRAPE_TIMEOUT_S));
+        http::async_read(stream, buffer, req, [self = shared_from_this()](beast::error_code ec, size_t) {
+            if (!ec) {
+                self->Answer();
+            }
+        });
+    }
+
+    void Answer() {
+        res = { http::status::ok, req.version() };
+        res.set(http::field::server, "eansearch");
+        if (req.method() != http::verb::get || req.target() != "/metrics") {
+            res.result(http::status::not_found);
+        } else {
+            res.set(http::field::content_type, PROMETHEUS_CONTENT_TYPE);
+            res.body() = exporter->Render();
+        }
+        res.keep_alive(false);
+        res.prepare_payload();
+        http::async_write(stream, res, [self = shared_from_this()](beast::error_code ec, size_t) {
+            self->stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+        });
+    }
+};
+
+/**
+ * @brief Accepts scrapes on an io_context run by the exporter thread.
+ */
+struct MetricsExporter::Listener {
+    net::io_context ioc;
+    tcp::acceptor acceptor { ioc };
+    const MetricsExporter * exporter;
+
+    void Accept() {
+        acceptor.async_accept([this](beast::error_code ec, tcp::socket socket) {
+            if (ec) {
+                return; // acceptor closed by Stop()
+            }
+            // scrapes are rare and small, the exporter thread serves them all
+            make_shared<Scrape>(move(socket), exporter)->Start();
+            Accept();
+        });
+    }
+};
+
+MetricsExporter::MetricsExporter(const EANSearch * api) {
+    this->api = api;
+}
+
+MetricsExporter::~MetricsExporter() {
+    Stop();
+}
+
+string MetricsExporter::Render() const
+{
+    return Render(api->GetMetrics());
+}
+
+bool MetricsExporter::Listen(const string & address, unsigned short port)
+{
+    if (listener) {
+        cerr << "Error: metrics listener is already running" << endl;
+        return false;
+    }
+    listener.reset(new Listener());
+    listener->exporter = this;
+    try {
+        tcp::endpoint endpoint(net::ip::make_address(address), port);
+        listener->acceptor.open(endpoint.protocol());
+        listener->acceptor.set_option(net::socket_base::reuse_address(true));
+        listener->acceptor.bind(endpoint);
+        listener->acceptor.listen();
+    }
+    catch(std::exception const & e) {
+        cerr << "Error: " << e.what() << endl;
+        listener.reset();
+        return false;
+    }
+    listener->Accept();
+    worker = thread([this]() { listener->ioc.run(); });
+    return true;
+}
+
+void MetricsExporter::Stop()
+{
+    if (!listener) {
+        return;
+    }
+    // scrapes in progress are dropped with the io_context
+    listener->ioc.stop();
+    worker.join();
+    listener.reset();
+}
@@ -0,0 +1,87 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_PROMETHEUS_HPP
+#define EANSEARCH_PROMETHEUS_HPP
+
+#include "eansearch.hpp"
+#include <string>
+#include <thread>
+#include <memory>
+using namespace std;
+
+
+/// Content type of the text exposition format
+const char * const PROMETHEUS_CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+/**
+ * @brief Exports the metrics of an EANSearch object to Prometheus.
+ *
+ * Render() formats a metrics snapshot in the Prometheus text exposition
+ * format, which OpenMetrics scrapers accept as well. Listen() serves it on
+ * /metrics from a background thread; applications with their own HTTP
+ * server can call Render() from their handler instead.
+ *
+ * Exported metrics, all prefixed with "eansearch_":
+ * - requests_total{op,status}: requests by response status class
+ *   (2xx, 4xx, 429, 5xx) or "error" if no response was received
+ * - retries_total{op}, cache_hits_total{op}, cache_misses_total{op},
+ *   cache_hit_ratio{op}, bytes_sent_total{op}, bytes_received_total{op}
+ * - request_duration_seconds{op,phase}: histogram per request phase
+ * - in_flight_requests, credits_remaining
+ * - connections{state}, connection_pool_utilisation, connections_opened_total,
+ *   connection_reuses_total
+ * - rate_limit_wait_seconds: histogram of the time spent in the rate limiter
+ */
+class MetricsExporter
+{
+public:
+    /**
+     * @param api Client to export (not owned, must outlive the exporter).
+     */
+    MetricsExporter(const EANSearch * api);
+    ~MetricsExporter();
+
+    /**
+     * @brief Format the current metrics of the client.
+     */
+    string Render() const;
+
+    /**
+     * @brief Format a metrics snapshot.
+     * @param metrics Snapshot from EANSearch::GetMetrics().
+     * @return Metrics in the Prometheus text format.
+     *
+     * Histogram bucket bounds are rounded to the resolution of the
+     * underlying latency histograms (about 6%).
+     */
+    static string Render(const MetricsSnapshot & metrics);
+
+    /**
+     * @brief Serve the metrics over HTTP from a background thread.
+     * @param address Local address, e.g. "127.0.0.1" or "0.0.0.0".
+     * @param port TCP port, e.g. 9464.
+     * @return false if the address can't be bound or a listener is already running.
+     */
+    bool Listen(const string & address, unsigned short port);
+
+    /**
+     * @brief Stop the listener started with Listen().
+     */
+    void Stop();
+
+private:
+    struct Listener;
+
+    const EANSearch * api;
+    unique_ptr<Listener> listener;
+    thread worker;
+};
+
+#endif // EANSEARCH_PROMETHEUS_HPP
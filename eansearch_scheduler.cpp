@@ -0,0 +1,162 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_scheduler.hpp"
+#include <algorithm>
+
+using namespace std;
+
+RequestScheduler::RequestScheduler() {
+    this->max_in_flight = 0;
+    this->in_flight = 0;
+    this->virtual_time = 0;
+    for (int p = 0; p < PRIORITY_COUNT; p++) {
+        this->weights[p] = PRIORITY_WEIGHTS[p];
+        this->finish[p] = 0;
+    }
+    SetRate(0);
+}
+
+void RequestScheduler::SetRate(double rate, int burst)
+{
+    lock_guard<mutex> guard(lock);
+    this->rate = rate;
+    this->burst = burst < 1 ? 1 : burst;
+    this->tokens = this->burst;
+    this->last = chrono::steady_clock::now();
+    Dispatch();
+}
+
+void RequestScheduler::SetMaxInFlight(int requests)
+{
+    lock_guard<mutex> guard(lock);
+    max_in_flight = requests;
+    Dispatch();
+}
+
+void RequestScheduler::SetWeight(Priority priority, double weight)
+{
+    lock_guard<mutex> guard(lock);
+    weights[priority] = weight > 0 ? weight : 1;
+}
+
+chrono::microseconds RequestScheduler::Acquire(Priority priority, chrono::steady_clock::time_point deadline)
+{
+    auto start = chrono::steady_clock::now();
+    unique_lock<mutex> guard(lock);
+    Refill(start);
+    if (Idle() && Available()) {
+        Take();
+        return chrono::microseconds(0);
+    }
+    Waiter w;
+    w.granted = false;
+    w.finish = max(virtual_time, finish[priority]) + 1 / weights[priority];
+    finish[priority] = w.finish;
+    auto & queue = queues[priority];
+    queue.push_back(&w);
+    Dispatch();
+    while (!w.granted) {
+        auto now = chrono::steady_clock::now();
+        if (now >= deadline) {
+            queue.erase(find(queue.begin(), queue.end(), &w));
+            return chrono::microseconds(-1);
+        }
+        auto wake = deadline;
+        if (rate > 0 && tokens < 1) {
+            // nobody releases tokens, the waiters check when the next one is due
+            auto due = last + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>((1 - tokens) / rate));
+            wake = min(wake, due);
+        }
+        w.wake.wait_until(guard, wake);
+        if (!w.granted) {
+            Refill(chrono::steady_clock::now());
+            Dispatch();
+        }
+    }
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+}
+
+bool RequestScheduler::TryAcquire()
+{
+    lock_guard<mutex> guard(lock);
+    Refill(chrono::steady_clock::now());
+    if (Idle() && Available()) {
+        Take();
+        return true;
+    }
+    return false;
+}
+
+void RequestScheduler::Release()
+{
+    lock_guard<mutex> guard(lock);
+    in_flight--;
+    Refill(chrono::steady_clock::now());
+    Dispatch();
+}
+
+int64_t RequestScheduler::QueueDepth(Priority priority) const
+{
+    lock_guard<mutex> guard(lock);
+    return queues[priority].size();
+}
+
+void RequestScheduler::Refill(chrono::steady_clock::time_point now)
+{
+    if (rate <= 0) {
+        return;
+    }
+    tokens = min(burst, tokens + chrono::duration<double>(now - last).count() * rate);
+    last = now;
+}
+
+bool RequestScheduler::Available() const
+{
+    return (rate <= 0 || tokens >= 1) && (max_in_flight <= 0 || in_flight < max_in_flight);
+}
+
+bool RequestScheduler::Idle() const
+{
+    for (auto & queue : queues) {
+        if (!queue.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RequestScheduler::Take()
+{
+    if (rate > 0) {
+        tokens -= 1;
+    }
+    in_flight++;
+}
+
+void RequestScheduler::Dispatch()
+{
+    while (Available()) {
+        deque<Waiter *> * next = nullptr;
+        for (auto & queue : queues) {
+            if (!queue.empty() && (!next || queue.front()->finish < next->front()->finish)) {
+                next = &queue;
+            }
+        }
+        if (!next) {
+            return;
+        }
+        Waiter * w = next->front();
+        next->pop_front();
+        virtual_time = w->finish;
+        Take();
+        w->granted = true;
+        w->wake.notify_one();
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_SCHEDULER_HPP
+#define EANSEARCH_SCHEDULER_HPP
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include "eansearch.hpp"
+using namespace std;
+
+
+/// Default weights of the priority classes: when all are waiting, interactive requests get 16 of 21 turns
+const double PRIORITY_WEIGHTS[PRIORITY_COUNT] = { 16, 4, 1 };
+
+/**
+ * @brief Admits API requests by rate and concurrency, serving waiting requests by priority.
+ *
+ * A request needs a token from the token bucket and one of the slots for
+ * requests in flight, which bounds the connections. While both are free
+ * and nobody waits, requests go out right away. Otherwise they wait in
+ * one queue per priority class, and the queues are served by weighted
+ * fair queuing: each request gets a virtual finish time of the finish
+ * time of its predecessor in the class plus 1 / weight, and the request
+ * with the earliest finish time goes first. Interactive requests so
+ * overtake batch requests without starving them.
+ */
+class RequestScheduler
+{
+public:
+    RequestScheduler();
+
+    /**
+     * @brief Change rate and burst size of the token bucket.
+     * @param rate Requests per second (0 = unlimited).
+     * @param burst Number of requests that may be sent back to back.
+     */
+    void SetRate(double rate, int burst = 1);
+
+    /**
+     * @brief Limit the requests in flight.
+     * @param requests Requests at a time, 0 for no limit (default).
+     */
+    void SetMaxInFlight(int requests);
+
+    /**
+     * @brief Set the share of a priority class when all classes are waiting.
+     */
+    void SetWeight(Priority priority, double weight);
+
+    /**
+     * @brief Block until a request may be sent; Release() must follow when it is done.
+     * @param priority Class of the request.
+     * @param deadline Don't wait past this point in time.
+     * @return Time spent waiting, negative if the deadline passed first.
+     */
+    chrono::microseconds Acquire(Priority priority,
+                                 chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max());
+
+    /**
+     * @brief Admit a request only if it can go out right away and nobody is waiting.
+     * @return true if admitted; Release() must follow when it is done.
+     */
+    bool TryAcquire();
+
+    /**
+     * @brief Give the slot of a finished request to the next waiting one.
+     */
+    void Release();
+
+    /**
+     * @brief Requests waiting in a priority class.
+     */
+    int64_t QueueDepth(Priority priority) const;
+
+private:
+    RequestScheduler(const RequestScheduler &) = delete;
+    RequestScheduler & operator=(const RequestScheduler &) = delete;
+
+    struct Waiter {
+        double finish;
+        bool granted;
+        condition_variable wake;
+    };
+
+    /// Add the tokens accrued since the last call
+    void Refill(chrono::steady_clock::time_point now);
+    bool Available() const;
+    bool Idle() const;
+    void Take();
+    /// Admit waiting requests by finish time while tokens and slots are free
+    void Dispatch();
+
+    mutable mutex lock;
+    double rate;
+    double burst;
+    double tokens;
+    chrono::steady_clock::time_point last;
+    int max_in_flight;
+    int in_flight;
+    double weights[PRIORITY_COUNT];
+    /// Virtual finish time of the last request queued in each class
+    double finish[PRIORITY_COUNT];
+    /// Virtual finish time of the last request admitted
+    double virtual_time;
+    deque<Waiter *> queues[PRIORITY_COUNT];
+};
+
+#endif // EANSEARCH_SCHEDULER_HPP
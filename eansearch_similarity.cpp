@@ -0,0 +1,178 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_similarity.hpp"
+#include <algorithm>
+#include <thread>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+static const int LSH_ROWS = MINHASH_SIZE / LSH_BANDS;
+
+static uint64_t Mix(uint64_t x) {
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+void SimilarityIndex::Signature(const string & name, uint32_t * signature)
+{
+    // lower-case letters and digits, other ASCII characters collapse to one blank
+    string text = " ";
+    for (unsigned char c : name) {
+        if (c >= 'A' && c <= 'Z') {
+            text.push_back(c - 'A' + 'a');
+        } else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80) {
+            text.push_back(c);
+        } else if (text.back() != ' ') {
+            text.push_back(' ');
+        }
+    }
+    if (text.back() != ' ') {
+        text.push_back(' ');
+    }
+
+    fill(signature, signature + MINHASH_SIZE, UINT32_MAX);
+    for (size_t i = 0; i + 3 <= text.size(); i++) {
+        uint64_t trigram = (uint64_t)(unsigned char)text[i] << 16 | (uint64_t)(unsigned char)text[i + 1] << 8
+            | (unsigned char)text[i + 2];
+        uint64_t h = Mix(trigram);
+        // MINHASH_SIZE hash functions derived from two halves of one hash
+        uint32_t h1 = h, h2 = (h >> 32) | 1;
+        for (int k = 0; k < MINHASH_SIZE; k++) {
+            signature[k] = min(signature[k], h1 + k * h2);
+        }
+    }
+}
+
+/**
+ * @brief Count equal values of two signatures.
+ */
+static int Agreement(const uint32_t * a, const uint32_t * b) {
+    int equal = 0;
+#ifdef __SSE2__
+    for (int k = 0; k < MINHASH_SIZE; k += 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + k)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + k)));
+        equal += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+    }
+#else
+    for (int k = 0; k < MINHASH_SIZE; k++) {
+        equal += a[k] == b[k];
+    }
+#endif
+    return equal;
+}
+
+static uint64_t BandHash(const uint32_t * signature, int band) {
+    uint64_t h = band;
+    for (int r = 0; r < LSH_ROWS; r++) {
+        h = Mix(h ^ signature[band * LSH_ROWS + r]);
+    }
+    return h;
+}
+
+SimilarityIndex::SimilarityIndex(const SnapshotIndex * snapshot, int threads) {
+    this->snapshot = snapshot;
+    this->min_score = 0.3;
+    if (threads <= 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    size_t n = snapshot->Size();
+    signatures.resize(n * MINHASH_SIZE);
+    buckets.resize(LSH_BANDS);
+
+    // signatures in parallel over row ranges
+    vector<thread> workers;
+    size_t chunk = (n + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([this, snapshot, t, chunk, n]() {
+            for (size_t row = t * chunk; row < min(n, (t + 1) * chunk); row++) {
+                Signature(string(snapshot->NameAt(row)), &signatures[row * MINHASH_SIZE]);
+            }
+        });
+    }
+    for (auto & w : workers) {
+        w.join();
+    }
+    workers.clear();
+
+    // bucket tables in parallel, each thread owns whole bands
+    for (int t = 0; t < threads && t < LSH_BANDS; t++) {
+        workers.emplace_back([this, t, threads, n]() {
+            for (int band = t; band < LSH_BANDS; band += threads) {
+                auto & table = buckets[band];
+                for (size_t row = 0; row < n; row++) {
+                    table[BandHash(&signatures[row * MINHASH_SIZE], band)].push_back(row);
+                }
+            }
+        });
+    }
+    for (auto & w : workers) {
+        w.join();
+    }
+}
+
+int SimilarityIndex::Language() const
+{
+    return snapshot->Language();
+}
+
+void SimilarityIndex::SetMinScore(double score)
+{
+    min_score = score;
+}
+
+void SimilarityIndex::Match(const string & name, vector<pair<double, uint32_t>> & matches) const
+{
+    matches.clear();
+    uint32_t signature[MINHASH_SIZE];
+    Signature(name, signature);
+
+    vector<uint32_t> candidates;
+    for (int band = 0; band < LSH_BANDS; band++) {
+        auto it = buckets[band].find(BandHash(signature, band));
+        if (it != buckets[band].end()) {
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (uint32_t row : candidates) {
+        double score = (double)Agreement(signature, &signatures[(size_t)row * MINHASH_SIZE]) / MINHASH_SIZE;
+        if (score >= min_score) {
+            matches.push_back(make_pair(score, row));
+        }
+    }
+    sort(matches.begin(), matches.end(), [](const pair<double, uint32_t> & a, const pair<double, uint32_t> & b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+}
+
+ProductList * SimilarityIndex::Search(const string & name, int page, int page_size) const
+{
+    vector<pair<double, uint32_t>> matches;
+    Match(name, matches);
+    if (matches.empty() || page < 1 || page_size < 1) {
+        return nullptr;
+    }
+    ProductList * pl = new ProductList();
+    for (size_t i = (size_t)(page - 1) * page_size; i < matches.size() && pl->size() < (size_t)page_size; i++) {
+        pl->push_back(snapshot->ProductAt(matches[i].second));
+    }
+    return pl;
+}
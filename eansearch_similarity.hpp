@@ -0,0 +1,94 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_SIMILARITY_HPP
+#define EANSEARCH_SIMILARITY_HPP
+
+#include "eansearch.hpp"
+#include "eansearch_snapshot.hpp"
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+using namespace std;
+
+
+/// Number of MinHash values per name
+const int MINHASH_SIZE = 64;
+/// LSH bands; each band hashes MINHASH_SIZE / LSH_BANDS values. A pair with similarity s
+/// is a candidate with probability 1 - (1 - s^rows)^bands: 95% at the default min score 0.3
+const int LSH_BANDS = 32;
+
+/**
+ * @brief Local index for finding products with similar names.
+ *
+ * Each name is reduced to the set of its character trigrams and summarized
+ * by a MinHash signature; the share of equal signature values estimates
+ * the Jaccard similarity of two trigram sets. Signatures are split into
+ * bands and hashed into buckets (locality-sensitive hashing), so a query
+ * only scores products that share a bucket with it.
+ */
+class SimilarityIndex
+{
+public:
+    /**
+     * @brief Build the index.
+     * @param snapshot Snapshot with the products (not owned, must outlive the index).
+     * @param threads Number of threads for the build (0 = one per core).
+     */
+    SimilarityIndex(const SnapshotIndex * snapshot, int threads = 0);
+
+    /**
+     * @brief Language of the product names.
+     */
+    int Language() const;
+
+    /**
+     * @brief Ignore products with a lower estimated similarity.
+     * @param score Minimum Jaccard similarity of the trigram sets, 0..1 (default 0.3).
+     *
+     * The bands are sized for the default: below about 0.2, similar
+     * products are increasingly missed (73% found at 0.2).
+     */
+    void SetMinScore(double score);
+
+    /**
+     * @brief Search products with similar names, best match first.
+     * @param name Search terms.
+     * @param page Page index (1-based, like SimilarProductSearch()).
+     * @param page_size Products per page.
+     * @return Pointer to ProductList, nullptr if no product is similar enough.
+     *
+     * Caller takes ownership of the returned ProductList and must delete it.
+     */
+    ProductList * Search(const string & name, int page, int page_size) const;
+
+    /**
+     * @brief Find snapshot rows with similar names.
+     * @param name Search terms.
+     * @param matches Receives (score, row) pairs ordered by descending score.
+     */
+    void Match(const string & name, vector<pair<double, uint32_t>> & matches) const;
+
+    /**
+     * @brief Compute the MinHash signature of a name.
+     * @param name Product name or search terms.
+     * @param signature Receives MINHASH_SIZE values.
+     */
+    static void Signature(const string & name, uint32_t * signature);
+
+private:
+    const SnapshotIndex * snapshot;
+    double min_score;
+    /// MINHASH_SIZE values per snapshot row
+    vector<uint32_t> signatures;
+    /// Rows by band hash, one table per band
+    vector<unordered_map<uint64_t, vector<uint32_t>>> buckets;
+};
+
+#endif // EANSEARCH_SIMILARITY_HPP
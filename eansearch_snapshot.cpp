@@ -0,0 +1,481 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_snapshot.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/**
+ * @brief Header of an index file; section offsets are relative to the file start.
+ *
+ * Sections, all with one entry per row unless noted:
+ * keys (uint64, sorted), eytzinger (uint64, count + 1 entries, 1-based),
+ * rank (uint32, row of each eytzinger entry), category_id and
+ * google_category_id (int32), name_offsets (uint32, count + 1 entries,
+ * into names), category_ref and country_ref (uint32, into the
+ * dictionaries), category_offsets and country_offsets (uint32,
+ * dictionary size + 1 entries, into category_names and country_names),
+ * coverage_offsets (uint32, coverage_count + 1 entries, into coverage).
+ *
+ * Coverage entries are the lines of a PrefixCrawler checkpoint without
+ * the space: "D<prefix>" for a crawled prefix, "S<prefix>" for a split one.
+ */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t language;
+    uint64_t count;
+    uint64_t categories;
+    uint64_t countries;
+    uint64_t keys;
+    uint64_t eytzinger;
+    uint64_t rank;
+    uint64_t category_id;
+    uint64_t google_category_id;
+    uint64_t name_offsets;
+    uint64_t names;
+    uint64_t category_ref;
+    uint64_t country_ref;
+    uint64_t category_offsets;
+    uint64_t category_names;
+    uint64_t country_offsets;
+    uint64_t country_names;
+    uint64_t coverage_count;
+    uint64_t coverage_offsets;
+    uint64_t coverage;
+    uint64_t size;
+};
+
+static const char SNAPSHOT_MAGIC[8] = { 'E', 'A', 'N', 'S', 'N', 'A', 'P', '1' };
+static const uint32_t SNAPSHOT_VERSION = 2;
+/// Prefix ranges are computed in the EAN-13 key space
+static const int SNAPSHOT_EAN_DIGITS = 13;
+
+/**
+ * @brief One product of a dump while an index is built.
+ */
+struct SnapshotRow {
+    uint64_t key;
+    string name;
+    int32_t category_id;
+    int32_t google_category_id;
+    uint32_t category_ref;
+    uint32_t country_ref;
+};
+
+/**
+ * @brief Collects distinct strings and numbers them in order of appearance.
+ */
+class Dictionary {
+public:
+    uint32_t Add(const string & s) {
+        auto it = ids.find(s);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        ids[s] = values.size();
+        values.push_back(s);
+        return values.size() - 1;
+    }
+    unordered_map<string, uint32_t> ids;
+    vector<string> values;
+};
+
+/**
+ * @brief Writes the sections of an index file, padded to 8 bytes.
+ */
+class SectionWriter {
+public:
+    SectionWriter(ofstream & out) : out(out), offset(sizeof(SnapshotHeader)) {
+        Pad();
+    }
+    template<class T> uint64_t Write(const vector<T> & v) {
+        return Write(v.data(), v.size() * sizeof(T));
+    }
+    uint64_t Write(const void * data, size_t size) {
+        uint64_t start = offset;
+        out.write(static_cast<const char *>(data), size);
+        offset += size;
+        Pad();
+        return start;
+    }
+    uint64_t Strings(const vector<string> & strings, uint64_t & offsets_section) {
+        vector<uint32_t> offsets;
+        string blob;
+        for (auto & s : strings) {
+            offsets.push_back(blob.size());
+            blob += s;
+        }
+        offsets.push_back(blob.size());
+        offsets_section = Write(offsets);
+        return Write(blob.data(), blob.size());
+    }
+    void Pad() {
+        static const char zeros[8] = { 0 };
+        size_t pad = (8 - offset % 8) % 8;
+        out.write(zeros, pad);
+        offset += pad;
+    }
+    ofstream & out;
+    uint64_t offset;
+};
+
+static string CleanField(const string & s) {
+    string out = s;
+    replace(out.begin(), out.end(), '\t', ' ');
+    replace(out.begin(), out.end(), '\n', ' ');
+    replace(out.begin(), out.end(), '\r', ' ');
+    return out;
+}
+
+void SnapshotIndex::WriteDumpLine(ostream & out, const Product & p)
+{
+    out << CleanField(p.ean) << '\t' << CleanField(p.name) << '\t' << p.categoryId << '\t'
+        << CleanField(p.categoryName) << '\t' << CleanField(p.issuingCountry);
+    auto * pf = dynamic_cast<const ProductFull *>(&p);
+    if (pf) {
+        out << '\t' << pf->googleCategoryId;
+    }
+    out << '\n';
+}
+
+bool SnapshotIndex::ParseKey(const string & ean, uint64_t & key)
+{
+    if (ean.empty() || ean.size() > 14) {
+        return false;
+    }
+    key = 0;
+    for (char c : ean) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        key = key * 10 + (c - '0');
+    }
+    return true;
+}
+
+/**
+ * @brief Fill the Eytzinger array with the sorted keys by an in-order walk.
+ */
+static void BuildEytzinger(const vector<SnapshotRow> & rows, vector<uint64_t> & eytzinger,
+                           vector<uint32_t> & rank, size_t & i, size_t k) {
+    if (k < eytzinger.size()) {
+        BuildEytzinger(rows, eytzinger, rank, i, 2 * k);
+        eytzinger[k] = rows[i].key;
+        rank[k] = i++;
+        BuildEytzinger(rows, eytzinger, rank, i, 2 * k + 1);
+    }
+}
+
+bool SnapshotIndex::Build(const string & dumpfile, const string & indexfile, int language,
+                          const string & checkpointfile)
+{
+    vector<string> coverage;
+    if (!checkpointfile.empty()) {
+        ifstream checkpoint(checkpointfile);
+        if (!checkpoint) {
+            cerr << "Error: can't open checkpoint file " << checkpointfile << endl;
+            return false;
+        }
+        string line;
+        while (getline(checkpoint, line)) {
+            if (line.size() >= 3 && (line[0] == 'D' || line[0] == 'S') && line[1] == ' ') {
+                coverage.push_back(line[0] + line.substr(2));
+            }
+        }
+    }
+
+    ifstream in(dumpfile);
+    if (!in) {
+        cerr << "Error: can't open dump file " << dumpfile << endl;
+        return false;
+    }
+    vector<SnapshotRow> rows;
+    Dictionary categories, countries;
+    string line;
+    while (getline(in, line)) {
+        vector<string> fields;
+        stringstream ss(line);
+        string field;
+        while (getline(ss, field, '\t')) {
+            fields.push_back(field);
+        }
+        SnapshotRow row;
+        if (fields.size() < 5 || !ParseKey(fields[0], row.key)) {
+            continue;
+        }
+        row.name = fields[1];
+        row.category_id = atoi(fields[2].c_str());
+        row.category_ref = categories.Add(fields[3]);
+        row.country_ref = countries.Add(fields[4]);
+        row.google_category_id = fields.size() > 5 ? atoi(fields[5].c_str()) : -1;
+        rows.push_back(move(row));
+    }
+
+    // sort by key, the last line of a duplicate wins
+    stable_sort(rows.begin(), rows.end(), [](const SnapshotRow & a, const SnapshotRow & b) { return a.key < b.key; });
+    vector<SnapshotRow> unique_rows;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (i + 1 < rows.size() && rows[i + 1].key == rows[i].key) {
+            continue;
+        }
+        unique_rows.push_back(move(rows[i]));
+    }
+    rows.swap(unique_rows);
+
+    size_t n = rows.size();
+    vector<uint64_t> keys(n), eytzinger(n + 1, 0);
+    vector<uint32_t> rank(n + 1, 0), category_ref(n), country_ref(n);
+    vector<int32_t> category_id(n), google_category_id(n);
+    vector<string> names(n);
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = rows[i].key;
+        category_id[i] = rows[i].category_id;
+        google_category_id[i] = rows[i].google_category_id;
+        category_ref[i] = rows[i].category_ref;
+        country_ref[i] = rows[i].country_ref;
+        names[i] = move(rows[i].name);
+    }
+    size_t i = 0;
+    BuildEytzinger(rows, eytzinger, rank, i, 1);
+
+    ofstream out(indexfile, ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Error: can't create index file " << indexfile << endl;
+        return false;
+    }
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    SectionWriter w(out);
+    header.keys = w.Write(keys);
+    header.eytzinger = w.Write(eytzinger);
+    header.rank = w.Write(rank);
+    header.category_id = w.Write(category_id);
+    header.google_category_id = w.Write(google_category_id);
+    header.names = w.Strings(names, header.name_offsets);
+    header.category_ref = w.Write(category_ref);
+    header.country_ref = w.Write(country_ref);
+    header.category_names = w.Strings(categories.values, header.category_offsets);
+    header.country_names = w.Strings(countries.values, header.country_offsets);
+    header.coverage = w.Strings(coverage, header.coverage_offsets);
+    header.size = w.offset;
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.language = language;
+    header.count = n;
+    header.categories = categories.values.size();
+    header.countries = countries.values.size();
+    header.coverage_count = coverage.size();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        cerr << "Error: can't write index file " << indexfile << endl;
+        return false;
+    }
+    return true;
+}
+
+SnapshotIndex::SnapshotIndex(const string & indexfile) {
+    map = nullptr;
+    map_size = 0;
+    header = nullptr;
+    fd = open(indexfile.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        cerr << "Error: can't open index file " << indexfile << ": " << strerror(errno) << endl;
+        return;
+    }
+    if ((size_t)st.st_size < sizeof(SnapshotHeader)) {
+        cerr << "Error: " << indexfile << " is not an index file" << endl;
+        return;
+    }
+    void * m = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        cerr << "Error: can't map index file " << indexfile << ": " << strerror(errno) << endl;
+        return;
+    }
+    map = static_cast<const char *>(m);
+    map_size = st.st_size;
+    auto * h = reinterpret_cast<const SnapshotHeader *>(map);
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0 || h->version != SNAPSHOT_VERSION
+        || h->size > map_size) {
+        cerr << "Error: " << indexfile << " is not an index file" << endl;
+        return;
+    }
+    header = h;
+
+    const uint32_t * offsets = Section<uint32_t>(header->coverage_offsets);
+    for (uint64_t i = 0; i < header->coverage_count; i++) {
+        string entry(Section<char>(header->coverage) + offsets[i], offsets[i + 1] - offsets[i]);
+        (entry[0] == 'D' ? done_prefixes : split_prefixes).insert(entry.substr(1));
+    }
+}
+
+SnapshotIndex::~SnapshotIndex() {
+    if (map) {
+        munmap(const_cast<char *>(map), map_size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+template<class T> const T * SnapshotIndex::Section(uint64_t offset) const
+{
+    return reinterpret_cast<const T *>(map + offset);
+}
+
+bool SnapshotIndex::IsOpen() const
+{
+    return header != nullptr;
+}
+
+size_t SnapshotIndex::Size() const
+{
+    return header ? header->count : 0;
+}
+
+int SnapshotIndex::Language() const
+{
+    return header ? header->language : Any;
+}
+
+bool SnapshotIndex::Find(uint64_t key, size_t & row) const
+{
+    if (!header) {
+        return false;
+    }
+    const uint64_t * eytzinger = Section<uint64_t>(header->eytzinger);
+    size_t n = header->count;
+    size_t k = 1;
+    while (k <= n) {
+        __builtin_prefetch(eytzinger + 16 * k); // 4 levels ahead
+        k = 2 * k + (eytzinger[k] < key);
+    }
+    // undo the right turns after the last left turn
+    k >>= __builtin_ffsll(~k);
+    if (k == 0 || eytzinger[k] != key) {
+        return false;
+    }
+    row = Section<uint32_t>(header->rank)[k];
+    return true;
+}
+
+uint64_t SnapshotIndex::KeyAt(size_t row) const
+{
+    return Section<uint64_t>(header->keys)[row];
+}
+
+string_view SnapshotIndex::NameAt(size_t row) const
+{
+    const uint32_t * offsets = Section<uint32_t>(header->name_offsets);
+    return string_view(Section<char>(header->names) + offsets[row], offsets[row + 1] - offsets[row]);
+}
+
+int SnapshotIndex::CategoryAt(size_t row) const
+{
+    return Section<int32_t>(header->category_id)[row];
+}
+
+ProductFull * SnapshotIndex::ProductAt(size_t row) const
+{
+    auto * p = new ProductFull();
+    // EAN-13 with leading zeros, GTIN-14 if longer
+    string ean = to_string(KeyAt(row));
+    if (ean.size() < 13) {
+        ean.insert(0, 13 - ean.size(), '0');
+    }
+    p->ean = ean;
+    p->name = string(NameAt(row));
+    p->categoryId = CategoryAt(row);
+    p->googleCategoryId = Section<int32_t>(header->google_category_id)[row];
+
+    const uint32_t * offsets = Section<uint32_t>(header->category_offsets);
+    uint32_t ref = Section<uint32_t>(header->category_ref)[row];
+    p->categoryName.assign(Section<char>(header->category_names) + offsets[ref], offsets[ref + 1] - offsets[ref]);
+    offsets = Section<uint32_t>(header->country_offsets);
+    ref = Section<uint32_t>(header->country_ref)[row];
+    p->issuingCountry.assign(Section<char>(header->country_names) + offsets[ref], offsets[ref + 1] - offsets[ref]);
+    return p;
+}
+
+ProductFull * SnapshotIndex::Lookup(const string & ean) const
+{
+    uint64_t key;
+    size_t row;
+    if (!ParseKey(ean, key) || !Find(key, row)) {
+        return nullptr;
+    }
+    return ProductAt(row);
+}
+
+bool SnapshotIndex::CoversPrefix(const string & prefix) const
+{
+    for (size_t len = 1; len <= prefix.size(); len++) {
+        if (done_prefixes.count(prefix.substr(0, len))) {
+            return true;
+        }
+    }
+    if (!split_prefixes.count(prefix)) {
+        return false;
+    }
+    for (char digit = '0'; digit <= '9'; digit++) {
+        if (!CoversPrefix(prefix + digit)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SnapshotIndex::PrefixRange(const string & prefix, size_t & first, size_t & last) const
+{
+    uint64_t key;
+    if (!header || (int)prefix.size() > SNAPSHOT_EAN_DIGITS || !ParseKey(prefix, key)) {
+        return false;
+    }
+    // all EAN-13 keys starting with the prefix lie in [lo, hi)
+    uint64_t scale = 1;
+    for (int i = prefix.size(); i < SNAPSHOT_EAN_DIGITS; i++) {
+        scale *= 10;
+    }
+    uint64_t lo = key * scale;
+    uint64_t hi = (key + 1) * scale;
+    const uint64_t * keys = Section<uint64_t>(header->keys);
+    first = lower_bound(keys, keys + header->count, lo) - keys;
+    last = lower_bound(keys + first, keys + header->count, hi) - keys;
+    return true;
+}
+
+ProductList * SnapshotIndex::PrefixSearch(const string & prefix, int page, int page_size) const
+{
+    size_t first, last;
+    if (page < 0 || page_size < 1 || !CoversPrefix(prefix) || !PrefixRange(prefix, first, last)) {
+        return nullptr;
+    }
+    ProductList * pl = new ProductList();
+    for (size_t row = first + (size_t)page * page_size; row < last && pl->size() < (size_t)page_size; row++) {
+        pl->push_back(ProductAt(row));
+    }
+    return pl;
+}
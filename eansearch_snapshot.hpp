@@ -0,0 +1,170 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_SNAPSHOT_HPP
+#define EANSEARCH_SNAPSHOT_HPP
+
+#include "eansearch.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <unordered_set>
+using namespace std;
+
+
+struct SnapshotHeader;
+
+/**
+ * @brief Read-only index of a product snapshot, memory-mapped from a file.
+ *
+ * Products are stored in columns sorted by EAN. Barcodes are kept as
+ * 64-bit keys, both sorted and in Eytzinger (breadth-first) order,
+ * which makes a lookup a short, cache-friendly walk down an implicit
+ * binary tree. Names, categories and countries live in side tables.
+ *
+ * Indexes are built from a dump with one product per line, as written
+ * by WriteDumpLine(), e.g. from the products of a PrefixCrawler run.
+ * The crawler's checkpoint file tells which prefixes the snapshot holds
+ * completely, so prefix searches for them can be answered locally.
+ */
+class SnapshotIndex
+{
+public:
+    /**
+     * @brief Write a product as one line of a dump file.
+     * @param out Output stream.
+     * @param p Product.
+     *
+     * Fields are separated by tabs: ean, name, categoryId, categoryName,
+     * issuingCountry and, for a ProductFull, googleCategoryId.
+     */
+    static void WriteDumpLine(ostream & out, const Product & p);
+
+    /**
+     * @brief Build an index file from a dump.
+     * @param dumpfile Dump with one product per line.
+     * @param indexfile Index file to write.
+     * @param language Language of the product names (Language enum).
+     * @param checkpointfile PrefixCrawler checkpoint of the crawl that produced the dump (optional).
+     * @return true on success.
+     *
+     * Lines with an invalid barcode are skipped; for duplicate barcodes the last line wins.
+     */
+    static bool Build(const string & dumpfile, const string & indexfile, int language = English,
+                      const string & checkpointfile = "");
+
+    /**
+     * @brief Convert a barcode to its numeric key.
+     * @param ean Barcode (up to 14 digits).
+     * @param key Receives the key.
+     * @return false if the barcode isn't numeric or too long.
+     */
+    static bool ParseKey(const string & ean, uint64_t & key);
+
+    /**
+     * @brief Open an index file.
+     * @param indexfile Index file written by Build().
+     *
+     * Check IsOpen() for errors.
+     */
+    SnapshotIndex(const string & indexfile);
+    ~SnapshotIndex();
+
+    /**
+     * @brief Check if the index could be opened.
+     */
+    bool IsOpen() const;
+
+    /**
+     * @brief Number of products in the index.
+     */
+    size_t Size() const;
+
+    /**
+     * @brief Language of the product names.
+     */
+    int Language() const;
+
+    /**
+     * @brief Lookup a barcode.
+     * @param ean Barcode.
+     * @return Pointer to ProductFull, nullptr if not in the index. Caller must delete it.
+     */
+    ProductFull * Lookup(const string & ean) const;
+
+    /**
+     * @brief Find the row of a key.
+     * @param key Numeric barcode.
+     * @param row Receives the row number (rows are sorted by key).
+     * @return true if found.
+     */
+    bool Find(uint64_t key, size_t & row) const;
+
+    /**
+     * @brief Key of a row.
+     */
+    uint64_t KeyAt(size_t row) const;
+
+    /**
+     * @brief Product in a row.
+     * @param row Row number, less than Size().
+     * @return Pointer to ProductFull. Caller must delete it.
+     */
+    ProductFull * ProductAt(size_t row) const;
+
+    /**
+     * @brief Name of the product in a row, without copying.
+     */
+    string_view NameAt(size_t row) const;
+
+    /**
+     * @brief Category id of the product in a row.
+     */
+    int CategoryAt(size_t row) const;
+
+    /**
+     * @brief Check if the snapshot holds all products with a prefix.
+     * @param prefix Barcode prefix digits.
+     * @return true if the prefix, or all its children, were crawled completely.
+     */
+    bool CoversPrefix(const string & prefix) const;
+
+    /**
+     * @brief Find the rows of all EAN-13 barcodes starting with a prefix.
+     * @param prefix Barcode prefix digits.
+     * @param first Receives the first row.
+     * @param last Receives the row after the last one.
+     * @return false if the prefix isn't valid.
+     */
+    bool PrefixRange(const string & prefix, size_t & first, size_t & last) const;
+
+    /**
+     * @brief Search products by barcode prefix, paged like BarcodePrefixSearch().
+     * @param prefix Barcode prefix digits.
+     * @param page Page index (0-based).
+     * @param page_size Products per page.
+     * @return Pointer to ProductList, nullptr if the prefix isn't covered.
+     *
+     * Caller takes ownership of the returned ProductList and must delete it.
+     */
+    ProductList * PrefixSearch(const string & prefix, int page, int page_size) const;
+
+private:
+    template<class T> const T * Section(uint64_t offset) const;
+
+    int fd;
+    const char * map;
+    size_t map_size;
+    const SnapshotHeader * header;
+    /// Coverage from the crawler checkpoint
+    unordered_set<string> done_prefixes;
+    unordered_set<string> split_prefixes;
+};
+
+#endif // EANSEARCH_SNAPSHOT_HPP
@@ -0,0 +1,242 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include "eansearch_textindex.hpp"
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief Intersect two sorted id lists.
+ * @param a First list.
+ * @param b Second list.
+ * @param out Receives the ids in both lists.
+ *
+ * The SSE2 version compares four ids of each list at once, all sixteen
+ * pairs with four rotations, and advances the list with the smaller last id.
+ */
+static void Intersect(const vector<uint32_t> & a, const vector<uint32_t> & b, vector<uint32_t> & out) {
+    out.clear();
+    size_t i = 0, j = 0;
+#ifdef __SSE2__
+    while (i + 4 <= a.size() && j + 4 <= b.size()) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&a[i]));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&b[j]));
+        __m128i eq = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        for (int k = 0; k < 4; k++) {
+            if (mask & (1 << k)) {
+                out.push_back(a[i + k]);
+            }
+        }
+        uint32_t a_last = a[i + 3], b_last = b[j + 3];
+        if (a_last <= b_last) {
+            i += 4;
+        }
+        if (b_last <= a_last) {
+            j += 4;
+        }
+    }
+#endif
+    while (i < a.size() && j < b.size()) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (b[j] < a[i]) {
+            j++;
+        } else {
+            out.push_back(a[i]);
+            i++;
+            j++;
+        }
+    }
+}
+
+static void PutVarint(vector<uint8_t> & bytes, uint32_t v) {
+    while (v >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(v));
+}
+
+void ProductIndex::Tokenize(const string & name, vector<string> & words)
+{
+    words.clear();
+    string word;
+    for (unsigned char c : name) {
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80) {
+            word.push_back(c);
+        } else if (c >= 'A' && c <= 'Z') {
+            word.push_back(c - 'A' + 'a');
+        } else if (!word.empty()) {
+            words.push_back(word);
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(word);
+    }
+}
+
+ProductIndex::ProductIndex(const SnapshotIndex * snapshot) {
+    this->snapshot = snapshot;
+    size_t n = snapshot->Size();
+
+    // number products by category
+    rows.resize(n);
+    for (size_t row = 0; row < n; row++) {
+        rows[row] = row;
+    }
+    stable_sort(rows.begin(), rows.end(), [snapshot](uint32_t a, uint32_t b) {
+        return snapshot->CategoryAt(a) < snapshot->CategoryAt(b);
+    });
+    for (uint32_t id = 0; id < n; id++) {
+        int category = snapshot->CategoryAt(rows[id]);
+        auto it = categories.find(category);
+        if (it == categories.end()) {
+            categories[category] = make_pair(id, id + 1);
+        } else {
+            it->second.second = id + 1;
+        }
+    }
+
+    // collect ascending id lists, then compress them
+    unordered_map<string, vector<uint32_t>> lists;
+    vector<string> name_words;
+    for (uint32_t id = 0; id < n; id++) {
+        Tokenize(string(snapshot->NameAt(rows[id])), name_words);
+        for (auto & w : name_words) {
+            auto & list = lists[w];
+            if (list.empty() || list.back() != id) {
+                list.push_back(id);
+            }
+        }
+    }
+    for (auto & entry : lists) {
+        auto & list = entry.second;
+        Postings postings { static_cast<uint32_t>(list.size()), static_cast<uint32_t>(blocks.size()), 0 };
+        for (size_t i = 0; i < list.size(); i++) {
+            if (i % POSTING_BLOCK_SIZE == 0) {
+                blocks.push_back(Block { list[i], static_cast<uint32_t>(bytes.size()) });
+                postings.blocks++;
+            } else {
+                PutVarint(bytes, list[i] - list[i - 1]);
+            }
+        }
+        words[entry.first] = postings;
+    }
+}
+
+int ProductIndex::Language() const
+{
+    return snapshot->Language();
+}
+
+size_t ProductIndex::RowOf(uint32_t id) const
+{
+    return rows[id];
+}
+
+/**
+ * @brief Decode the ids of a posting list in [lo, hi), skipping blocks outside the range.
+ */
+void ProductIndex::Decode(const Postings & postings, uint32_t lo, uint32_t hi, vector<uint32_t> & ids) const
+{
+    ids.clear();
+    const Block * first = &blocks[postings.first_block];
+    const Block * end = first + postings.blocks;
+    // the last block starting at or before lo
+    const Block * b = upper_bound(first, end, lo, [](uint32_t id, const Block & block) { return id < block.first_id; });
+    if (b != first) {
+        b--;
+    }
+    uint32_t remaining = postings.count - (b - first) * POSTING_BLOCK_SIZE;
+    for (; b != end && b->first_id < hi; b++) {
+        const uint8_t * p = &bytes[b->offset];
+        uint32_t id = b->first_id;
+        uint32_t in_block = min<uint32_t>(remaining, POSTING_BLOCK_SIZE);
+        remaining -= in_block;
+        for (uint32_t k = 0; ; ) {
+            if (id >= hi) {
+                break;
+            }
+            if (id >= lo) {
+                ids.push_back(id);
+            }
+            if (++k == in_block) {
+                break;
+            }
+            uint32_t delta = 0;
+            for (int shift = 0; ; shift += 7) {
+                uint8_t byte = *p++;
+                delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) {
+                    break;
+                }
+            }
+            id += delta;
+        }
+    }
+}
+
+void ProductIndex::Match(const string & name, int category, vector<uint32_t> & ids) const
+{
+    ids.clear();
+    uint32_t lo = 0, hi = rows.size();
+    if (category >= 0) {
+        auto it = categories.find(category);
+        if (it == categories.end()) {
+            return;
+        }
+        lo = it->second.first;
+        hi = it->second.second;
+    }
+    vector<string> query_words;
+    Tokenize(name, query_words);
+    vector<const Postings *> lists;
+    for (auto & w : query_words) {
+        auto it = words.find(w);
+        if (it == words.end()) {
+            return;
+        }
+        lists.push_back(&it->second);
+    }
+    if (lists.empty()) {
+        return;
+    }
+    // shortest list first keeps the intermediate results small
+    sort(lists.begin(), lists.end(), [](const Postings * a, const Postings * b) { return a->count < b->count; });
+    Decode(*lists[0], lo, hi, ids);
+    vector<uint32_t> list, result;
+    for (size_t i = 1; i < lists.size() && !ids.empty(); i++) {
+        Decode(*lists[i], ids.front(), ids.back() + 1, list);
+        Intersect(ids, list, result);
+        ids.swap(result);
+    }
+}
+
+ProductList * ProductIndex::Search(const string & name, int category, int page, int page_size) const
+{
+    vector<uint32_t> ids;
+    Match(name, category, ids);
+    if (ids.empty() || page < 0 || page_size < 1) {
+        return nullptr;
+    }
+    ProductList * pl = new ProductList();
+    for (size_t i = (size_t)page * page_size; i < ids.size() && pl->size() < (size_t)page_size; i++) {
+        pl->push_back(snapshot->ProductAt(rows[ids[i]]));
+    }
+    return pl;
+}
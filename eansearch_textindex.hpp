@@ -0,0 +1,110 @@
+/*
+ * A C++ class for EAN and ISBN name lookup and validation using the API on ean-search.org
+ * https://www.ean-search.org/ean-database-api.html
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#ifndef EANSEARCH_TEXTINDEX_HPP
+#define EANSEARCH_TEXTINDEX_HPP
+
+#include "eansearch.hpp"
+#include "eansearch_snapshot.hpp"
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <unordered_map>
+using namespace std;
+
+
+/// Document ids per block of a compressed posting list
+const int POSTING_BLOCK_SIZE = 128;
+
+/**
+ * @brief In-memory inverted index over the product names of a snapshot.
+ *
+ * Maps each word of a product name to the list of products containing it.
+ * Products are numbered by category, so the products of one category form
+ * a contiguous id range and a category search only decodes the blocks of
+ * each posting list that overlap that range. Posting lists are stored as
+ * delta-encoded varints in blocks of POSTING_BLOCK_SIZE ids and
+ * intersected with SIMD instructions where available.
+ *
+ * Words are separated by anything but letters, digits and non-ASCII
+ * characters; ASCII letters are compared case-insensitively.
+ */
+class ProductIndex
+{
+public:
+    /**
+     * @brief Build the index.
+     * @param snapshot Snapshot with the products (not owned, must outlive the index).
+     */
+    ProductIndex(const SnapshotIndex * snapshot);
+
+    /**
+     * @brief Language of the product names.
+     */
+    int Language() const;
+
+    /**
+     * @brief Search products containing all words of a name.
+     * @param name Search terms.
+     * @param category Category id, -1 for all categories.
+     * @param page Page index (0-based).
+     * @param page_size Products per page.
+     * @return Pointer to ProductList, nullptr if no product matches.
+     *
+     * Results are ordered by category and barcode. Caller takes ownership
+     * of the returned ProductList and must delete it.
+     */
+    ProductList * Search(const string & name, int category, int page, int page_size) const;
+
+    /**
+     * @brief Find the ids of all products containing all words of a name.
+     * @param name Search terms.
+     * @param category Category id, -1 for all categories.
+     * @param ids Receives the matching product ids in ascending order.
+     */
+    void Match(const string & name, int category, vector<uint32_t> & ids) const;
+
+    /**
+     * @brief Snapshot row of a product id.
+     */
+    size_t RowOf(uint32_t id) const;
+
+    /**
+     * @brief Split a name into lower-case words.
+     * @param name Product name or search terms.
+     * @param words Receives the words.
+     */
+    static void Tokenize(const string & name, vector<string> & words);
+
+private:
+    /// Location of a posting list in the shared byte array
+    struct Postings {
+        uint32_t count;
+        uint32_t first_block;
+        uint32_t blocks;
+    };
+    /// First id and byte offset of a block of a posting list
+    struct Block {
+        uint32_t first_id;
+        uint32_t offset;
+    };
+
+    void Decode(const Postings & postings, uint32_t lo, uint32_t hi, vector<uint32_t> & ids) const;
+
+    const SnapshotIndex * snapshot;
+    /// Snapshot row of each product id
+    vector<uint32_t> rows;
+    /// Product id range [first, second) of each category
+    map<int, pair<uint32_t, uint32_t>> categories;
+    unordered_map<string, Postings> words;
+    vector<Block> blocks;
+    vector<uint8_t> bytes;
+};
+
+#endif // EANSEARCH_TEXTINDEX_HPP
@@ -0,0 +1,308 @@
+/*
+ * eansearchd - local caching proxy for the API on ean-search.org
+ *
+ * Serves the /api?op=... interface over local HTTP or a Unix domain socket.
+ * Responses are answered from a cache shared by all processes on the host;
+ * misses are forwarded through one rate-limited EANSearch object, so all
+ * local clients share one token, one rate limit and one cache.
+ * Upstream request metrics are served on /metrics for Prometheus.
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <unistd.h>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/strand.hpp>
+#include "eansearch.hpp"
+#include "eansearch_cache.hpp"
+#include "eansearch_prometheus.hpp"
+using namespace std;
+
+namespace beast = boost::beast; // from <boost/beast.hpp>
+namespace http = beast::http;   // from <boost/beast/http.hpp>
+namespace net = boost::asio;    // from <boost/asio.hpp>
+using tcp = net::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
+using unix_socket = net::local::stream_protocol;
+
+/// Threads serving the connections, by default; a miss holds its thread until upstream answers
+const int DAEMON_THREADS = 16;
+/// Client connections without a request for this long are closed
+const int SESSION_IDLE_SECONDS = 60;
+
+struct Proxy {
+	EANSearch * api;
+	ResultCache * cache;
+};
+
+static void Usage() {
+	cerr << "Usage: eansearchd [options]" << endl
+		<< "  --listen ADDR:PORT   listen on TCP (default 127.0.0.1:8080)" << endl
+		<< "  --unix PATH          listen on a Unix domain socket instead" << endl
+		<< "  --shm NAME           shared memory cache (default /eansearchd)" << endl
+		<< "  --cache-file FILE    persistent cache file instead of shared memory" << endl
+		<< "  --cache-size N       number of cache entries (default 1000000)" << endl
+		<< "  --max-age SECONDS    expire cached responses (default: never)" << endl
+		<< "  --rate N             upstream requests per second (default: unlimited)" << endl
+		<< "  --upstream HOST:PORT upstream API server (default api.ean-search.org:443)" << endl
+		<< "  --threads N          threads serving requests (default 16)" << endl
+		<< "The API token is read from EAN_SEARCH_API_TOKEN." << endl;
+}
+
+/**
+ * @brief Extract the query parameters to forward from a request target.
+ * @param target Request target, e.g. "/api?op=barcode-lookup&ean=...&token=...".
+ * @param params Receives the parameters without token and format.
+ * @param op Receives the value of the op parameter.
+ * @return false if the target isn't an API request.
+ */
+static bool UpstreamParams(const string & target, string & params, string & op) {
+	auto q = target.find('?');
+	if (target.compare(0, q, "/api") != 0 || q == string::npos) {
+		return false;
+	}
+	params.clear();
+	op.clear();
+	size_t start = q + 1;
+	while (start <= target.size()) {
+		size_t end = target.find('&', start);
+		if (end == string::npos) {
+			end = target.size();
+		}
+		string param = target.substr(start, end - start);
+		start = end + 1;
+		if (param.empty() || param.compare(0, 6, "token=") == 0 || param.compare(0, 7, "format=") == 0) {
+			continue; // the proxy uses its own token and always asks for JSON
+		}
+		if (param.compare(0, 3, "op=") == 0) {
+			op = param.substr(3);
+		}
+		params += (params.empty() ? "" : "&") + param;
+	}
+	return !op.empty();
+}
+
+static http::response<http::string_body> Handle(const http::request<http::string_body> & req, Proxy * proxy) {
+	http::response<http::string_body> res{http::status::ok, req.version()};
+	res.set(http::field::server, "eansearchd");
+	res.set(http::field::content_type, "application/json");
+	res.keep_alive(req.keep_alive());
+
+	string params, op;
+	if (req.method() != http::verb::get) {
+		res.result(http::status::method_not_allowed);
+	} else if (req.target() == "/metrics") {
+		res.set(http::field::content_type, PROMETHEUS_CONTENT_TYPE);
+		res.body() = MetricsExporter::Render(proxy->api->GetMetrics());
+	} else if (!UpstreamParams(string(req.target().data(), req.target().size()), params, op)) {
+		res.result(http::status::not_found);
+	} else {
+		// account status must always come from upstream
+		bool cacheable = proxy->cache && op != "account-status";
+		int status = 0;
+		if (cacheable && proxy->cache->Get(params, res.body())) {
+			res.set("X-Cache", "HIT");
+		} else if (proxy->api->Query(params, res.body(), status)) {
+			if (cacheable) {
+				proxy->cache->Put(params, res.body());
+			}
+			res.set("X-Cache", "MISS");
+		} else if (status > 0) {
+			// e.g. 429 or 400, clients handle them as with the API itself
+			res.result(static_cast<http::status>(status));
+		} else {
+			res.result(http::status::bad_gateway);
+			res.body() = "{\"error\":\"upstream request failed\"}";
+		}
+		if (res.result() == http::status::ok) {
+			// clients of the API read it from every response, hits report the last known value;
+			// it is unknown until the first upstream response, asking for it would block the hit
+			int credits = proxy->api->GetMetrics().credits_remaining;
+			if (credits >= 0) {
+				res.set("X-Credits-Remaining", to_string(credits));
+			}
+		}
+	}
+	if (res.result() == http::status::method_not_allowed || res.result() == http::status::not_found) {
+		res.body() = "{\"error\":\"invalid request\"}";
+	}
+	res.prepare_payload();
+	return res;
+}
+
+/**
+ * @brief Serve HTTP/1.1 requests on one client connection until it is closed.
+ *
+ * Idle connections only hold a pending read, not a thread.
+ */
+template<class Protocol>
+class Session : public enable_shared_from_this<Session<Protocol>> {
+public:
+	Session(typename Protocol::socket socket, Proxy * proxy) : stream(move(socket)) {
+		this->proxy = proxy;
+	}
+
+	void Read() {
+		req = {};
+		stream.expires_after(chrono::seconds(SESSION_IDLE_SECONDS));
+		http::async_read(stream, buffer, req, [self = this->shared_from_this()](beast::error_code ec, size_t) {
+			self->OnRead(ec);
+		});
+	}
+
+private:
+	void OnRead(beast::error_code ec) {
+		if (ec) {
+			Close();
+			return;
+		}
+		res = Handle(req, proxy);
+		stream.expires_after(chrono::seconds(SESSION_IDLE_SECONDS));
+		http::async_write(stream, res, [self = this->shared_from_this()](beast::error_code ec, size_t) {
+			self->OnWrite(ec);
+		});
+	}
+
+	void OnWrite(beast::error_code ec) {
+		if (ec || !res.keep_alive()) {
+			Close();
+			return;
+		}
+		Read();
+	}
+
+	void Close() {
+		beast::error_code ec;
+		stream.socket().shutdown(net::socket_base::shutdown_send, ec);
+	}
+
+	beast::basic_stream<Protocol> stream;
+	beast::flat_buffer buffer;
+	http::request<http::string_body> req;
+	http::response<http::string_body> res;
+	Proxy * proxy;
+};
+
+template<class Acceptor>
+static void Accept(net::io_context & ioc, Acceptor & acceptor, Proxy * proxy) {
+	typedef typename Acceptor::protocol_type Protocol;
+	// a strand per connection, so its reads, writes and timer don't run concurrently
+	acceptor.async_accept(net::make_strand(ioc), [&ioc, &acceptor, proxy](beast::error_code ec, typename Protocol::socket socket) {
+		if (ec) {
+			cerr << "Error: " << ec.message() << endl;
+		} else {
+			make_shared<Session<Protocol>>(move(socket), proxy)->Read();
+		}
+		Accept(ioc, acceptor, proxy);
+	});
+}
+
+/**
+ * @brief Serve connections on a fixed number of threads, which also bounds the requests forwarded at a time.
+ */
+template<class Acceptor>
+static void Serve(net::io_context & ioc, Acceptor & acceptor, Proxy * proxy, int threads) {
+	Accept(ioc, acceptor, proxy);
+	vector<thread> workers;
+	for (int i = 1; i < threads; i++) {
+		workers.emplace_back([&ioc]() { ioc.run(); });
+	}
+	ioc.run();
+	for (auto & t : workers) {
+		t.join();
+	}
+}
+
+int main(int argc, char * argv[]) {
+	string listen = "127.0.0.1:8080", unix_path, shm = "/eansearchd", cache_file, upstream;
+	uint64_t cache_size = 1000000;
+	int max_age = 0, threads = DAEMON_THREADS;
+	double rate = 0;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (i + 1 >= argc) {
+			Usage();
+			return 1;
+		}
+		string value = argv[++i];
+		if (arg == "--listen") {
+			listen = value;
+		} else if (arg == "--unix") {
+			unix_path = value;
+		} else if (arg == "--shm") {
+			shm = value;
+		} else if (arg == "--cache-file") {
+			cache_file = value;
+		} else if (arg == "--cache-size") {
+			cache_size = stoull(value);
+		} else if (arg == "--max-age") {
+			max_age = stoi(value);
+		} else if (arg == "--rate") {
+			rate = stod(value);
+		} else if (arg == "--upstream") {
+			upstream = value;
+		} else if (arg == "--threads") {
+			threads = max(stoi(value), 1);
+		} else {
+			Usage();
+			return 1;
+		}
+	}
+
+	auto token = getenv("EAN_SEARCH_API_TOKEN");
+	if (token == nullptr) {
+		cout << "Please check your API token" << endl;
+		return 1;
+	}
+	EANSearch api(token);
+	api.SetRateLimit(rate);
+	if (!upstream.empty()) {
+		auto colon = upstream.rfind(':');
+		api.SetEndpoint(upstream.substr(0, colon), colon == string::npos ? "443" : upstream.substr(colon + 1));
+	}
+
+	MappedCache * cache;
+	if (!cache_file.empty()) {
+		cache = new DiskCache(cache_file, cache_size);
+	} else {
+		cache = new SharedMemoryCache(shm, cache_size);
+	}
+	if (!cache->IsOpen()) {
+		return 1;
+	}
+	cache->SetMaxAge(max_age);
+	if (!cache->IsWriter()) {
+		cerr << "Warning: cache file is read-only, responses will not be added" << endl;
+	}
+	Proxy proxy { &api, cache };
+
+	try {
+		net::io_context ioc;
+		if (!unix_path.empty()) {
+			unlink(unix_path.c_str());
+			unix_socket::acceptor acceptor(ioc, unix_socket::endpoint(unix_path));
+			Serve(ioc, acceptor, &proxy, threads);
+		} else {
+			auto colon = listen.rfind(':');
+			auto address = net::ip::make_address(listen.substr(0, colon));
+			auto port = static_cast<unsigned short>(stoi(listen.substr(colon + 1)));
+			tcp::acceptor acceptor(ioc, tcp::endpoint(address, port));
+			Serve(ioc, acceptor, &proxy, threads);
+		}
+	}
+	catch(std::exception const & e) {
+		cerr << "Error: " << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
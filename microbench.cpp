@@ -0,0 +1,155 @@
+/*
+ * microbench - CPU cost of request encoding and response parsing
+ *
+ * Measures urlencode, ParseProductList and ProductFromJSON from the
+ * library's internal eansearch_codec.hpp on canned API responses, without
+ * any network access. Reports nanoseconds, heap allocations and allocated
+ * bytes per call.
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <cstdlib>
+#include <boost/json.hpp>
+#include "eansearch.hpp"
+#include "eansearch_codec.hpp"
+#include "eansearch_mock.hpp"
+using namespace std;
+
+namespace json = boost::json;   // from <boost/json.hpp>
+
+/// Heap usage of this program; the benchmarks are single-threaded
+static atomic<uint64_t> allocations(0);
+static atomic<uint64_t> allocated_bytes(0);
+
+// Every form goes through these two. They aren't inlined, so GCC doesn't
+// pair the free() with a new-expression (-Wmismatched-new-delete).
+[[gnu::noinline]] void * operator new(size_t size) {
+	allocations.fetch_add(1, memory_order_relaxed);
+	allocated_bytes.fetch_add(size, memory_order_relaxed);
+	if (void * p = malloc(size ? size : 1)) {
+		return p;
+	}
+	throw bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void * p) noexcept {
+	free(p);
+}
+
+void * operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete[](void * p) noexcept {
+	operator delete(p);
+}
+
+void operator delete(void * p, size_t) noexcept {
+	operator delete(p);
+}
+
+void operator delete[](void * p, size_t) noexcept {
+	operator delete(p);
+}
+
+/// Keep the compiler from removing a benchmarked call
+template<class T>
+static void Use(const T & value) {
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+class Microbench
+{
+public:
+	Microbench(int min_millis, const string & filter) : min_millis(min_millis), filter(filter) { }
+
+	/**
+	 * @brief Time a function, doubling the iterations until it runs for min_millis.
+	 */
+	void Run(const string & name, const function<void()> & f) {
+		if (!filter.empty() && name.find(filter) == string::npos) {
+			return;
+		}
+		f(); // warm up
+		for (uint64_t iterations = 1; ; iterations *= 2) {
+			uint64_t allocs = allocations, bytes = allocated_bytes;
+			auto start = chrono::steady_clock::now();
+			for (uint64_t i = 0; i < iterations; i++) {
+				f();
+			}
+			double nanos = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+			if (nanos >= min_millis * 1e6 || iterations >= (1ULL << 40)) {
+				cout << left << setw(40) << name << right << fixed << setprecision(1)
+					<< setw(12) << nanos / iterations
+					<< setw(12) << (double)(allocations - allocs) / iterations
+					<< setw(12) << (double)(allocated_bytes - bytes) / iterations << endl;
+				return;
+			}
+		}
+	}
+
+private:
+	int min_millis;
+	string filter;
+};
+
+int main(int argc, char * argv[]) {
+	int min_millis = 200;
+	string filter;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		string arg = argv[i];
+		if (arg == "--min-time") {
+			min_millis = stoi(argv[i + 1]);
+		} else if (arg == "--filter") {
+			filter = argv[i + 1];
+		} else {
+			cerr << "Usage: microbench [--min-time MILLIS] [--filter SUBSTRING]" << endl;
+			return 1;
+		}
+	}
+	Microbench bench(min_millis, filter);
+	cout << left << setw(40) << "benchmark" << right << setw(12) << "ns/op" << setw(12) << "allocs/op"
+		<< setw(12) << "bytes/op" << endl;
+
+	const pair<const char *, string> queries[] = {
+		{ "ascii", "Bananaboat" },
+		{ "words", "iPhone 15 Pro Max 256GB Titan" },
+		{ "unicode", "Crème brûlée 抹茶 Ёлочная гирлянда" },
+		{ "long", string(40, ' ') + string(1000, 'x') + "&=?/" + string(1000, 'y') }
+	};
+	for (auto & q : queries) {
+		bench.Run(string("urlencode/") + q.first, [&q]() {
+			Use(urlencode(q.second));
+		});
+	}
+
+	for (int page_size : { 1, 10, 100 }) {
+		string body = MockAPIServer::Response("op=product-search&name=x&page=0", page_size);
+		bench.Run("ParseProductList/" + to_string(page_size), [&body]() {
+			DeleteProductList(ParseProductList(body));
+		});
+	}
+
+	// with and without googleCategoryId, as in lookups and search results
+	auto lookup = json::parse(MockAPIServer::Response("op=barcode-lookup&ean=4007249000011", 1));
+	auto search = json::parse(MockAPIServer::Response("op=product-search&name=x&page=0", 1));
+	const pair<const char *, const json::value *> products[] = {
+		{ "full", &lookup.at(0) },
+		{ "basic", &search.at("productlist").at(0) }
+	};
+	for (auto & p : products) {
+		bench.Run(string("ProductFromJSON/") + p.first, [&p]() {
+			delete ProductFromJSON(*p.second);
+		});
+	}
+	return 0;
+}
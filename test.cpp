@@ -0,0 +1,302 @@
+/*
+ * test - checks of eansearchd and AsyncEANSearch against a local mock of the API
+ *
+ * Starts a MockAPIServer and ./eansearchd in front of it, sends plain
+ * HTTP requests to the daemon and checks the responses, then destroys
+ * AsyncEANSearch objects with calls in flight, checks the circuit
+ * breaker of pipelined batches and that EANSearch and AsyncEANSearch
+ * share cached responses. No API token or network access is
+ * needed. Run with "make check".
+ *
+ * (c) 2025 Relaxed Communications GmBH, <info@relaxedcommunications.com>
+ *
+ * License: MIT https://opensource.org/license/mit
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include "eansearch.hpp"
+#include "eansearch_breaker.hpp"
+#include "eansearch_budget.hpp"
+#include "eansearch_cache.hpp"
+#include "eansearch_executor.hpp"
+#include "eansearch_mock.hpp"
+using namespace std;
+
+namespace beast = boost::beast; // from <boost/beast.hpp>
+namespace http = beast::http;   // from <boost/beast/http.hpp>
+namespace net = boost::asio;    // from <boost/asio.hpp>
+using tcp = net::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
+
+extern char ** environ;
+
+static int failures = 0;
+
+static void Check(bool ok, const string & what) {
+	cout << (ok ? "ok   " : "FAIL ") << what << endl;
+	if (!ok) {
+		failures++;
+	}
+}
+
+/**
+ * @brief A local TCP port that was free a moment ago.
+ */
+static unsigned short FreePort() {
+	net::io_context ioc;
+	tcp::acceptor acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+	return acceptor.local_endpoint().port();
+}
+
+/**
+ * @brief Send a GET request on a new connection.
+ * @return false if there was no response.
+ */
+static bool Get(unsigned short port, const string & target, http::response<http::string_body> & res) {
+	try {
+		net::io_context ioc;
+		beast::tcp_stream stream(ioc);
+		stream.expires_after(chrono::seconds(30));
+		stream.connect(tcp::endpoint(net::ip::make_address("127.0.0.1"), port));
+		http::request<http::empty_body> req{http::verb::get, target, 11};
+		req.set(http::field::host, "localhost");
+		http::write(stream, req);
+		beast::flat_buffer buffer;
+		res = {};
+		http::read(stream, buffer, res);
+		beast::error_code ec;
+		stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+	}
+	catch(std::exception const & e) {
+		return false;
+	}
+	return true;
+}
+
+static void TestDaemon() {
+	MockAPIServer mock;
+	mock.SetCredits(500);
+	if (!mock.Listen()) {
+		Check(false, "mock server started");
+		return;
+	}
+	unsigned short port = FreePort();
+	string cache_file = "/tmp/eansearchd-test-" + to_string(getpid()) + ".cache";
+	remove(cache_file.c_str());
+	string listen = "127.0.0.1:" + to_string(port);
+	string upstream = "localhost:" + to_string(mock.Port());
+	const char * argv[] = { "./eansearchd", "--listen", listen.c_str(), "--cache-file", cache_file.c_str(),
+	                        "--upstream", upstream.c_str(), "--threads", "2", nullptr };
+	setenv("EAN_SEARCH_API_TOKEN", "test", 1);
+	pid_t daemon;
+	if (posix_spawn(&daemon, argv[0], nullptr, nullptr, const_cast<char **>(argv), environ) != 0) {
+		Check(false, "eansearchd started");
+		return;
+	}
+
+	http::response<http::string_body> res;
+	bool up = false;
+	for (int i = 0; i < 100 && !up; i++) {
+		this_thread::sleep_for(chrono::milliseconds(50));
+		up = Get(port, "/metrics", res);
+	}
+	Check(up, "eansearchd accepts connections");
+	if (up) {
+		string target = "/api?op=barcode-lookup&ean=5099750442227&token=abc";
+		bool answered = Get(port, target, res);
+		Check(answered && res.result() == http::status::ok && res["X-Cache"] == "MISS", "first lookup is a MISS");
+		Check(answered && mock.Requests() == 1, "MISS is forwarded upstream");
+		Check(answered && res["X-Credits-Remaining"] == "500", "MISS has X-Credits-Remaining");
+		string body = res.body();
+
+		answered = Get(port, target, res);
+		Check(answered && res.result() == http::status::ok && res["X-Cache"] == "HIT", "second lookup is a HIT");
+		Check(answered && mock.Requests() == 1, "HIT is not forwarded upstream");
+		Check(answered && res["X-Credits-Remaining"] == "500", "HIT has X-Credits-Remaining");
+		Check(answered && res.body() == body, "HIT returns the cached response");
+
+		mock.SetThrottle(1);
+		answered = Get(port, "/api?op=barcode-lookup&ean=4007249146012", res);
+		Check(answered && res.result() == http::status::too_many_requests, "upstream 429 is passed through");
+		Check(answered && res.count("X-Credits-Remaining") == 0, "errors have no X-Credits-Remaining");
+	}
+
+	kill(daemon, SIGTERM);
+	waitpid(daemon, nullptr, 0);
+	remove(cache_file.c_str());
+}
+
+static string Ean(int i) {
+	string n = to_string(i % 100000);
+	return "40072490" + string(5 - n.size(), '0') + n;
+}
+
+/**
+ * @brief Whether all calls have delivered their result, deleting the products.
+ */
+static bool AllReady(vector<future<ProductFull *>> & results) {
+	bool ready = true;
+	for (auto & f : results) {
+		if (f.wait_for(chrono::seconds(0)) != future_status::ready) {
+			ready = false;
+		} else {
+			delete f.get();
+		}
+	}
+	return ready;
+}
+
+static void TestAsyncDestructor() {
+	MockAPIServer mock;
+	mock.SetLatency(20000);
+	if (!mock.Listen()) {
+		Check(false, "mock server started");
+		return;
+	}
+	EANSearch api("mock-token");
+	api.SetEndpoint("localhost", to_string(mock.Port()));
+
+	// own CPU pool: delete right after the calls went out
+	auto async = new AsyncEANSearch(&api, nullptr, 4);
+	vector<future<ProductFull *>> results;
+	for (int i = 0; i < 32; i++) {
+		results.push_back(async->BarcodeLookup(Ean(i)));
+	}
+	delete async;
+	Check(AllReady(results), "destructor waits for the calls of its own pool");
+
+	// external CPU pool, blocked until the destructor is waiting: the responses can't be parsed before
+	WorkStealingPool cpu(1);
+	atomic<bool> release { false };
+	async = new AsyncEANSearch(&api, &cpu, 4);
+	results.clear();
+	for (int i = 0; i < 32; i++) {
+		results.push_back(async->BarcodeLookup(Ean(100 + i)));
+	}
+	cpu.Post([&release]() {
+		while (!release) {
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+	});
+	atomic<bool> deleted { false };
+	thread deleter([&]() {
+		delete async;
+		deleted = true;
+	});
+	this_thread::sleep_for(chrono::milliseconds(200));
+	Check(!deleted, "destructor waits for responses queued on an external pool");
+	release = true;
+	deleter.join();
+	Check(AllReady(results), "all calls delivered before the destructor returned");
+}
+
+static void TestBatchBreaker() {
+	MockAPIServer mock;
+	mock.SetCredits(500);
+	mock.SetLatency(100000);
+	if (!mock.Listen()) {
+		Check(false, "mock server started");
+		return;
+	}
+	EANSearch api("mock-token");
+	api.SetEndpoint("localhost", to_string(mock.Port()));
+	// one slow request opens the circuit, one trial request closes it again
+	BreakerPolicy breaker;
+	breaker.error_rate = 0;
+	breaker.slow = chrono::milliseconds(50);
+	breaker.min_requests = 1;
+	breaker.open_for = chrono::milliseconds(100);
+	breaker.probes = 1;
+	api.SetCircuitBreaker(breaker);
+	// with 500 credits left, only interactive calls are admitted
+	BudgetPolicy budget;
+	budget.reserve = 1000;
+	api.SetCreditBudget(budget);
+	api.SetPipelineDepth(4);
+
+	{
+		ScopedPriority interactive(PriorityInteractive);
+		delete api.BarcodeLookup(Ean(1));
+	}
+	Check(api.GetMetrics().circuit_state == CircuitBreaker::Open, "slow response opens the circuit");
+	this_thread::sleep_for(chrono::milliseconds(150));
+	mock.SetLatency(0);
+
+	// half-open now: the batch takes the trial request, then the budget refuses it
+	vector<string> params { "op=barcode-lookup&ean=" + Ean(2), "op=barcode-lookup&ean=" + Ean(3) }, results;
+	Check(api.QueryBatch(params, results) == 0, "budget refuses the batch");
+
+	ScopedPriority interactive(PriorityInteractive);
+	ProductFull * p = api.BarcodeLookup(Ean(4));
+	Check(p != nullptr, "trial request is still allowed after a refused batch");
+	delete p;
+	Check(api.GetMetrics().circuit_state == CircuitBreaker::Closed, "trial request closes the circuit");
+
+	// half-open again with a slow server: the pipeline may only send the one trial request
+	EANSearch batch_api("mock-token");
+	batch_api.SetEndpoint("localhost", to_string(mock.Port()));
+	batch_api.SetCircuitBreaker(breaker);
+	batch_api.SetPipelineDepth(4);
+	mock.SetLatency(100000);
+	delete batch_api.BarcodeLookup(Ean(5));
+	this_thread::sleep_for(chrono::milliseconds(150));
+	uint64_t before = mock.Requests();
+	params.clear();
+	for (int i = 0; i < 4; i++) {
+		params.push_back("op=barcode-lookup&ean=" + Ean(10 + i));
+	}
+	batch_api.QueryBatch(params, results);
+	Check(mock.Requests() - before == 1, "half-open breaker lets one request of a pipeline through");
+	Check(batch_api.GetMetrics().circuit_state == CircuitBreaker::Open, "slow trial request opens the circuit again");
+}
+
+static void TestSharedCacheKeys() {
+	MockAPIServer mock;
+	if (!mock.Listen()) {
+		Check(false, "mock server started");
+		return;
+	}
+	string cache_file = "/tmp/eansearch-test-" + to_string(getpid()) + ".cache";
+	remove(cache_file.c_str());
+	DiskCache cache(cache_file, 1024, 2048);
+	EANSearch api("mock-token");
+	api.SetEndpoint("localhost", to_string(mock.Port()));
+	api.SetCache(&cache);
+	AsyncEANSearch async(&api, nullptr, 1);
+
+	// AsyncEANSearch answers from what EANSearch cached and the other way round
+	delete api.BarcodeLookup(Ean(1));
+	delete async.BarcodeLookup(Ean(1)).get();
+	Check(mock.Requests() == 1, "async lookup hits the entry of a lookup");
+	for (ProductFull * p : async.BatchBarcodeLookup({ Ean(1), Ean(2) }).get()) {
+		delete p;
+	}
+	Check(mock.Requests() == 2, "async batch only sends the lookup that isn't cached");
+	for (ProductFull * p : api.BatchBarcodeLookup({ Ean(2) })) {
+		delete p;
+	}
+	Check(mock.Requests() == 2, "batch hits the entry of an async batch");
+	remove(cache_file.c_str());
+}
+
+int main() {
+	TestDaemon();
+	TestAsyncDestructor();
+	TestBatchBreaker();
+	TestSharedCacheKeys();
+	cout << (failures ? to_string(failures) + " checks failed" : "all checks passed") << endl;
+	return failures ? 1 : 0;
+}